@@ -53,3 +53,49 @@ struct scnhdr {
         DWORD           s_flags;        /* flags */
       };
  
+
+/* The symbolic header, at f_symptr.  Only the external symbol table 
+ * (and its strings) is used, to carry procedure names over to NOFF.
+ */
+typedef struct symhdr {
+        short   magic;          /* SYMHMAGIC                            */
+        short   vstamp;         /* version stamp                        */
+        DWORD   ilineMax;       /* number of line number entries        */
+        DWORD   cbLine;         /* size of the line number table        */
+        DWORD   cbLineOffset;
+        DWORD   idnMax;         /* dense numbers                        */
+        DWORD   cbDnOffset;
+        DWORD   ipdMax;         /* procedure descriptors                */
+        DWORD   cbPdOffset;
+        DWORD   isymMax;        /* local symbols                        */
+        DWORD   cbSymOffset;
+        DWORD   ioptMax;        /* optimization symbols                 */
+        DWORD   cbOptOffset;
+        DWORD   iauxMax;        /* auxiliary symbols                    */
+        DWORD   cbAuxOffset;
+        DWORD   issMax;         /* local strings                        */
+        DWORD   cbSsOffset;
+        DWORD   issExtMax;      /* external strings                     */
+        DWORD   cbSsExtOffset;
+        DWORD   ifdMax;         /* file descriptors                     */
+        DWORD   cbFdOffset;
+        DWORD   crfd;           /* relative file descriptors            */
+        DWORD   cbRfdOffset;
+        DWORD   iextMax;        /* external symbols                     */
+        DWORD   cbExtOffset;
+      } HDRR;
+
+#define SYMHMAGIC 0x7009
+
+typedef struct extr {
+        short   flags;          /* symbol flags                         */
+        short   ifd;            /* file this symbol comes from          */
+        DWORD   iss;            /* index of the name in the strings     */
+        DWORD   value;          /* address, for a procedure             */
+        unsigned int bits;      /* st:6, sc:5, reserved:1, index:20     */
+      } EXTR;
+
+#define SYM_TYPE(bits)  ((bits) & 0x3f)
+#define SYM_CLASS(bits) (((bits) >> 6) & 0x1f)
+#define stProc          6       /* a procedure                          */
+#define scText          1       /* in the text segment                  */
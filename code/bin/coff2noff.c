@@ -10,6 +10,10 @@
  * 	ld with  -N -T 0
  * to make sure the object file has no shared text.
  *
+ * The procedure names in the external symbol table of the COFF file,
+ * if there is one, are copied after the segments, so that Nachos can
+ * tell which procedure a user PC belongs to (see noff.h).
+ *
  * Also assumes that the COFF file has at most 3 segments:
  *	.text	-- read-only executable instructions 
  *	.data	-- initialized data
@@ -30,6 +34,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "coff.h"
 #include "noff.h"
@@ -89,6 +94,69 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* qsort comparison routine: order symbols by address */
+int CompareSymbols(const void *a, const void *b)
+{
+    return ((NoffSymbol *) a)->value - ((NoffSymbol *) b)->value;
+}
+
+/* Copy the external procedures of the COFF file to the end of the NOFF 
+ * file.  Does nothing if the COFF file has been stripped.
+ */
+void WriteSymbols(int fdIn, int fdOut, struct filehdr *fileh)
+{
+    HDRR symh;
+    EXTR ext;
+    NoffSymHeader noffS;
+    NoffSymbol *symbols;
+    char *strings, *names;
+    int i, symptr = WordToHost(fileh->f_symptr);
+
+    if (symptr == 0)
+	return;
+    lseek(fdIn, symptr, 0);
+    ReadStruct(fdIn, symh);
+    if (ShortToHost(symh.magic) != SYMHMAGIC)
+	return;
+    symh.iextMax = WordToHost(symh.iextMax);
+    symh.cbExtOffset = WordToHost(symh.cbExtOffset);
+    symh.issExtMax = WordToHost(symh.issExtMax);
+    symh.cbSsExtOffset = WordToHost(symh.cbSsExtOffset);
+
+    strings = malloc(symh.issExtMax);
+    lseek(fdIn, symh.cbSsExtOffset, 0);
+    Read(fdIn, strings, symh.issExtMax);
+
+    symbols = (NoffSymbol *)malloc(symh.iextMax * sizeof(NoffSymbol));
+    names = malloc(symh.issExtMax);
+    noffS.symMagic = NOFFSYMMAGIC;
+    noffS.numSymbols = 0;
+    noffS.stringSize = 0;
+    lseek(fdIn, symh.cbExtOffset, 0);
+    for (i = 0; i < symh.iextMax; i++) {
+	ReadStruct(fdIn, ext);
+	ext.bits = WordToHost(ext.bits);
+	ext.iss = WordToHost(ext.iss);
+	if (SYM_TYPE(ext.bits) != stProc || SYM_CLASS(ext.bits) != scText
+			|| ext.iss < 0 || ext.iss >= symh.issExtMax)
+	    continue;
+	symbols[noffS.numSymbols].value = WordToHost(ext.value);
+	symbols[noffS.numSymbols].nameOffset = noffS.stringSize;
+	strcpy(names + noffS.stringSize, strings + ext.iss);
+	noffS.stringSize += strlen(strings + ext.iss) + 1;
+	noffS.numSymbols++;
+    }
+    qsort(symbols, noffS.numSymbols, sizeof(NoffSymbol), CompareSymbols);
+    printf("Copying %d symbols\n", noffS.numSymbols);
+
+    Write(fdOut, (char *)&noffS, sizeof(NoffSymHeader));
+    Write(fdOut, (char *)symbols, noffS.numSymbols * sizeof(NoffSymbol));
+    Write(fdOut, names, noffS.stringSize);
+    free(symbols);
+    free(names);
+    free(strings);
+}
+
 main (int argc, char **argv)
 {
     int fdIn, fdOut, numsections, i, inNoffFile;
@@ -219,6 +287,7 @@ main (int argc, char **argv)
 	    exit(1);
 	}
     }
+    WriteSymbols(fdIn, fdOut, &fileh);
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
     close(fdIn);
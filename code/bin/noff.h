@@ -23,3 +23,22 @@ typedef struct noffHeader {
 				 * should be zero'ed before use 
 				 */
 } NoffHeader;
+
+/* The symbols of the program follow the last segment in the file, when
+ * coff2noff could find them: a header, then "numSymbols" entries sorted
+ * by address, then the names, each null-terminated.  Older NOFF files
+ * have nothing after the segments.
+ */
+
+#define NOFFSYMMAGIC	0xbadf00d	/* marks the symbol table */
+
+typedef struct noffSymHeader {
+   int symMagic;		/* should be NOFFSYMMAGIC */
+   int numSymbols;		/* number of NoffSymbol entries */
+   int stringSize;		/* bytes of names, after the entries */
+} NoffSymHeader;
+
+typedef struct noffSymbol {
+   int value;			/* address of the procedure */
+   int nameOffset;		/* where its name starts, in the names */
+} NoffSymbol;
@@ -23,21 +23,30 @@
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written back through the metadata journal (the two files are
+//	kept open during all this time).  The journal groups the changes
+//	of several operations into one sequential log write, and installs
+//	them on disk after the group is committed (cf. journal.h).  If the
+//	operation fails, and we have modified part of the directory and/or
+//	bitmap, we simply discard the changed version, without writing it
+//	back to disk.
+//
+//	Operations that only read the directory (Open, List, Print) may
+//	run concurrently; Create, Remove and Sync hold the file system lock
+//	exclusively, so they see and leave a consistent bitmap, directory
+//	and journal.  Reads and writes of the data of open files are not
+//	synchronized.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
 //	   files cannot be bigger than about 3KB in size
 //	   there is no hierarchical directory structure, and only a limited
 //	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   only metadata is made robust to failures: if Nachos exits
+//	    in the middle of an operation, the operation is either
+//	    entirely applied or entirely lost, but file data written
+//	    since the last commit may be lost
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -50,12 +59,16 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
+#include "synch.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
-// sectors, so that they can be located on boot-up.
+// the directory of files, and the metadata journal.  These file headers
+// are placed in well-known sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
+#define JournalSector 		2
 
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number 
@@ -64,6 +77,11 @@
 #define NumDirEntries 		10
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
+// Most sectors a single Create or Remove can modify: one file header,
+// plus the whole directory and bitmap files.
+#define MaxMetadataSectors	(1 + divRoundUp(DirectoryFileSize, SectorSize) \
+				   + divRoundUp(FreeMapFileSize, SectorSize))
+
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format == true, the disk has
@@ -71,8 +89,9 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).  
 //
-//	If format == false, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format == false, we just have to replay the journal, in case
+//	Nachos stopped in the middle of installing a committed group,
+//	and open the files representing the bitmap and the directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -80,24 +99,35 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+
+    // The disk geometry is chosen at startup (cf. disk.h); the bitmap
+    // must fill whole words, and a Create or Remove must fit in the log.
+    ASSERT((NumSectors % BitsInWord) == 0);
+    ASSERT(MaxMetadataSectors <= NumLogSectors);
+    lock = new RWLock("file system");
+
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
+	FileHeader *logHdr = new FileHeader;
 
         DEBUG('f', "Formatting the file system.\n");
 
-    // First, allocate space for FileHeaders for the directory and bitmap
-    // (make sure no one else grabs these!)
+    // First, allocate space for FileHeaders for the directory, bitmap
+    // and journal (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	freeMap->Mark(JournalSector);
 
     // Second, allocate space for the data blocks containing the contents
-    // of the directory and bitmap files.  There better be enough space!
+    // of the directory, bitmap and journal files.  There better be enough
+    // space!  The disk is empty, so the journal gets consecutive sectors.
 
 	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
 	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(logHdr->Allocate(freeMap, JournalFileSize));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -107,6 +137,7 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing headers back to disk.\n");
 	mapHdr->WriteBack(FreeMapSector);    
 	dirHdr->WriteBack(DirectorySector);
+	logHdr->WriteBack(JournalSector);
 
     // OK to open the bitmap and directory files now
     // The file system operations assume these two files are left open
@@ -114,6 +145,8 @@ FileSystem::FileSystem(bool format)
 
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        journal = new Journal(JournalSector);
+        journal->Format();
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
@@ -124,6 +157,7 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
 	directory->WriteBack(directoryFile);
+	synchDisk->SetJournal(journal);		 // from now on, journal them
 
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
@@ -133,15 +167,50 @@ FileSystem::FileSystem(bool format)
 	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
+	delete logHdr;
 	}
     } else {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // if we are not formatting the disk, finish installing the last
+    // committed group of metadata changes, if Nachos stopped before it
+    // was done, and then open the files representing the bitmap and
+    // directory; these are left open while Nachos is running
+        journal = new Journal(JournalSector);
+        journal->Recover();
+        synchDisk->SetJournal(journal);
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Commit any metadata changes still held by the journal, and close
+//	the bitmap and directory files.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    synchDisk->SetJournal(NULL);
+    delete journal;			// commits what is pending
+    delete freeMapFile;
+    delete directoryFile;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Force the metadata changes made so far to be committed to disk,
+//	instead of waiting for the journal to fill up.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    lock->AcquireWrite();
+    journal->Commit();
+    lock->ReleaseWrite();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
@@ -156,6 +225,10 @@ FileSystem::FileSystem(bool format)
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
 //
+//	All of the disk writes are part of a single journal transaction,
+//	so they reach the disk together or not at all.  The file system
+//	lock is held exclusively throughout.
+//
 //	Return true if everything goes ok, otherwise, return false.
 //
 // 	Create fails if:
@@ -164,9 +237,6 @@ FileSystem::FileSystem(bool format)
 //	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
@@ -182,6 +252,8 @@ FileSystem::Create(const char *name, int initialSize)
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
+    lock->AcquireWrite();
+    journal->Begin(MaxMetadataSectors);
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
 
@@ -211,6 +283,8 @@ FileSystem::Create(const char *name, int initialSize)
         delete freeMap;
     }
     delete directory;
+    journal->End();
+    lock->ReleaseWrite();
     return success;
 }
 
@@ -220,6 +294,7 @@ FileSystem::Create(const char *name, int initialSize)
 //	To open a file:
 //	  Find the location of the file's header, using the directory 
 //	  Bring the header into memory
+//	Several threads may be opening files at once.
 //
 //	"name" -- the text name of the file to be opened
 //----------------------------------------------------------------------
@@ -232,10 +307,12 @@ FileSystem::Open(const char *name)
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
+    lock->AcquireRead();
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
+    lock->ReleaseRead();
     delete directory;
     return openFile;				// return NULL if not found
 }
@@ -247,6 +324,7 @@ FileSystem::Open(const char *name)
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
+//	(as a single journal transaction)
 //
 //	Return true if the file was deleted, false if the file wasn't
 //	in the file system.
@@ -263,12 +341,15 @@ FileSystem::Remove(const char *name)
     int sector;
     
     directory = new Directory(NumDirEntries);
+    lock->AcquireWrite();
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name);
     if (sector == -1) {
+       lock->ReleaseWrite();
        delete directory;
        return false;			 // file not found 
     }
+    journal->Begin(MaxMetadataSectors);
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
@@ -281,6 +362,8 @@ FileSystem::Remove(const char *name)
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
     directory->WriteBack(directoryFile);        // flush to disk
+    journal->End();
+    lock->ReleaseWrite();
     delete fileHdr;
     delete directory;
     delete freeMap;
@@ -297,8 +380,10 @@ FileSystem::List()
 {
     Directory *directory = new Directory(NumDirEntries);
 
+    lock->AcquireRead();
     directory->FetchFrom(directoryFile);
     directory->List();
+    lock->ReleaseRead();
     delete directory;
 }
 
@@ -320,6 +405,7 @@ FileSystem::Print()
     BitMap *freeMap = new BitMap(NumSectors);
     Directory *directory = new Directory(NumDirEntries);
 
+    lock->AcquireRead();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -333,6 +419,7 @@ FileSystem::Print()
 
     directory->FetchFrom(directoryFile);
     directory->Print();
+    lock->ReleaseRead();
 
     delete bitHdr;
     delete dirHdr;
@@ -65,6 +65,9 @@ class FileSystem {
 };
 
 #else // FILESYS
+class Journal;
+class RWLock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -73,6 +76,8 @@ class FileSystem {
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();			// Commit pending metadata, and
+					// close the bitmap and directory
 
     bool Create(const char *name, int initialSize);  	
 					// Create a file (UNIX creat)
@@ -85,11 +90,18 @@ class FileSystem {
 
     void Print();			// List all the files and their contents
 
+    void Sync();			// Commit metadata changes still
+					// held by the journal
+
   private:
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   Journal* journal;			// Write-ahead log for changes to
+					// the bitmap, directory and headers
+   RWLock* lock;			// Held shared to read the directory,
+					// exclusive to change the metadata
 };
 
 #endif // FILESYS
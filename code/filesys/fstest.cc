@@ -7,6 +7,9 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   Benchmark -- a set of workloads to compare file system
+//		implementations, each reporting its cost in simulated time
+//		and disk requests
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +23,7 @@
 #include "thread.h"
 #include "disk.h"
 #include "stats.h"
+#include "filehdr.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -183,3 +187,269 @@ PerformanceTest()
     stats->Print();
 }
 
+
+//----------------------------------------------------------------------
+// Benchmark
+// 	Run one of the file system workloads below (or all of them, if
+//	"which" is "all"), and print one line of results for each, in the
+//	form:
+//
+//	   bench name=<workload> ops=<n> bytes=<n> ticks=<n> reads=<n>
+//		writes=<n> bytesPerKTick=<n>
+//
+//	"ticks", "reads" and "writes" are the simulated time and the disk
+//	requests used by the workload, taken from the Statistics; setting
+//	up and removing the files it works on is not counted.  Pending
+//	journal commits are flushed at both ends of the measurement.
+//
+//	The workloads are:
+//	  seqwrite, seqread -- write/read a file of the maximum size from
+//		start to end, one sector at a time
+//	  randwrite, randread -- the same, at random sector offsets
+//	  storm -- create, fill and remove many one-sector files
+//	  metadata -- create, open and remove many empty files
+//	  concurrent -- several threads, each reading its own file from
+//		start to end, then writing it at random offsets
+//
+//	The disk must be formatted and empty, e.g. "nachos -f -tb all".
+//----------------------------------------------------------------------
+
+#define BenchFileSize 	((int) MaxFileSize)
+#define BenchChunkSize 	SectorSize
+#define BenchNumChunks 	(BenchFileSize / BenchChunkSize)
+#define BenchPasses 	4		// times seqwrite/seqread go over
+					// the file
+#define BenchRandomOps 	(BenchPasses * BenchNumChunks)
+#define BenchRounds 	10		// rounds of storm and metadata
+#define BenchNumFiles 	8		// files per round; must fit in
+					// the directory
+#define BenchNumThreads 4		// threads in concurrent
+
+static int startTicks, startReads, startWrites;
+
+static const char *
+BenchFileName(int i)
+{
+    static char names[BenchNumFiles][16];
+
+    ASSERT(i < BenchNumFiles);
+    sprintf(names[i], "bench%d", i);
+    return names[i];
+}
+
+static void
+BenchStart()
+{
+    fileSystem->Sync();
+    startTicks = stats->totalTicks;
+    startReads = stats->numDiskReads;
+    startWrites = stats->numDiskWrites;
+}
+
+static void
+BenchReport(const char *name, int ops, int bytes)
+{
+    int ticks;
+
+    fileSystem->Sync();
+    ticks = stats->totalTicks - startTicks;
+    printf("bench name=%s ops=%d bytes=%d ticks=%d reads=%d writes=%d "
+	"bytesPerKTick=%lld\n", name, ops, bytes, ticks,
+	stats->numDiskReads - startReads, stats->numDiskWrites - startWrites,
+	(ticks > 0) ? (long long) bytes * 1000 / ticks : 0);
+}
+
+// Create file "i" with the benchmark size, and fill it.  Not measured.
+static void
+BenchCreate(int i)
+{
+    char buffer[BenchChunkSize];
+    OpenFile *openFile;
+
+    ASSERT(fileSystem->Create(BenchFileName(i), BenchFileSize));
+    openFile = fileSystem->Open(BenchFileName(i));
+    ASSERT(openFile != NULL);
+    memset(buffer, 'a' + i, BenchChunkSize);
+    for (int j = 0; j < BenchNumChunks; j++)
+	openFile->Write(buffer, BenchChunkSize);
+    delete openFile;
+}
+
+static void
+BenchRemove(int i)
+{
+    ASSERT(fileSystem->Remove(BenchFileName(i)));
+}
+
+// Read or write "file" from start to end "passes" times.  Return the
+// number of bytes transferred.
+static int
+BenchSequential(OpenFile *file, bool writing, int passes)
+{
+    char buffer[BenchChunkSize];
+    int bytes = 0;
+
+    memset(buffer, 'z', BenchChunkSize);
+    for (int p = 0; p < passes; p++)
+	for (int j = 0; j < BenchNumChunks; j++)
+	    if (writing)
+		bytes += file->WriteAt(buffer, BenchChunkSize,
+					j * BenchChunkSize);
+	    else
+		bytes += file->ReadAt(buffer, BenchChunkSize,
+					j * BenchChunkSize);
+    return bytes;
+}
+
+// Read or write "numOps" chunks of "file", at random offsets.
+static int
+BenchRandom(OpenFile *file, bool writing, int numOps)
+{
+    char buffer[BenchChunkSize];
+    int bytes = 0;
+    int offset;
+
+    memset(buffer, 'z', BenchChunkSize);
+    for (int j = 0; j < numOps; j++) {
+	offset = (Random() % BenchNumChunks) * BenchChunkSize;
+	if (writing)
+	    bytes += file->WriteAt(buffer, BenchChunkSize, offset);
+	else
+	    bytes += file->ReadAt(buffer, BenchChunkSize, offset);
+    }
+    return bytes;
+}
+
+static void
+BenchTransfer(const char *name, bool writing, bool sequential)
+{
+    OpenFile *openFile;
+    int bytes;
+
+    BenchCreate(0);
+    openFile = fileSystem->Open(BenchFileName(0));
+    ASSERT(openFile != NULL);
+    BenchStart();
+    if (sequential)
+	bytes = BenchSequential(openFile, writing, BenchPasses);
+    else
+	bytes = BenchRandom(openFile, writing, BenchRandomOps);
+    BenchReport(name, bytes / BenchChunkSize, bytes);
+    delete openFile;
+    BenchRemove(0);
+}
+
+static void BenchSeqWrite() { BenchTransfer("seqwrite", true, true); }
+static void BenchSeqRead() { BenchTransfer("seqread", false, true); }
+static void BenchRandWrite() { BenchTransfer("randwrite", true, false); }
+static void BenchRandRead() { BenchTransfer("randread", false, false); }
+
+static void
+BenchStorm()
+{
+    char buffer[SectorSize];
+    OpenFile *openFile;
+    int ops = 0, bytes = 0;
+
+    memset(buffer, 's', SectorSize);
+    BenchStart();
+    for (int r = 0; r < BenchRounds; r++) {
+	for (int i = 0; i < BenchNumFiles; i++) {
+	    ASSERT(fileSystem->Create(BenchFileName(i), SectorSize));
+	    openFile = fileSystem->Open(BenchFileName(i));
+	    ASSERT(openFile != NULL);
+	    bytes += openFile->Write(buffer, SectorSize);
+	    delete openFile;
+	    ops++;
+	}
+	for (int i = 0; i < BenchNumFiles; i++, ops++)
+	    BenchRemove(i);
+    }
+    BenchReport("storm", ops, bytes);
+}
+
+static void
+BenchMetadata()
+{
+    OpenFile *openFile;
+    int ops = 0;
+
+    BenchStart();
+    for (int r = 0; r < BenchRounds; r++) {
+	for (int i = 0; i < BenchNumFiles; i++, ops++)
+	    ASSERT(fileSystem->Create(BenchFileName(i), 0));
+	for (int i = 0; i < BenchNumFiles; i++, ops++) {
+	    openFile = fileSystem->Open(BenchFileName(i));
+	    ASSERT(openFile != NULL);
+	    delete openFile;
+	}
+	for (int i = 0; i < BenchNumFiles; i++, ops++)
+	    BenchRemove(i);
+    }
+    BenchReport("metadata", ops, 0);
+}
+
+static int concurrentBytes;
+
+// Body of each thread of the concurrent workload; "arg" is the index of
+// the file it works on.
+static void
+BenchWorker(void *arg)
+{
+    OpenFile *openFile = fileSystem->Open(BenchFileName((long) arg));
+
+    ASSERT(openFile != NULL);
+    concurrentBytes += BenchSequential(openFile, false, 1);
+    concurrentBytes += BenchRandom(openFile, true, BenchNumChunks);
+    delete openFile;
+}
+
+static void
+BenchConcurrent()
+{
+    Thread *workers[BenchNumThreads];
+
+    // Create and Remove are not safe to call from several threads at
+    // once, so the files are set up here.
+    for (long i = 0; i < BenchNumThreads; i++)
+	BenchCreate(i);
+    concurrentBytes = 0;
+    BenchStart();
+    for (long i = 0; i < BenchNumThreads; i++) {
+	workers[i] = new Thread(BenchFileName(i), 1, 0);
+	workers[i]->Fork(BenchWorker, (void *) i);
+    }
+    for (int i = 0; i < BenchNumThreads; i++)
+	currentThread->Join(workers[i]);
+    BenchReport("concurrent", concurrentBytes / BenchChunkSize, 
+		concurrentBytes);
+    for (int i = 0; i < BenchNumThreads; i++)
+	BenchRemove(i);
+}
+
+static struct {
+    const char *name;
+    VoidNoArgFunctionPtr run;
+} benchmarks[] = {
+    { "seqwrite", BenchSeqWrite },
+    { "seqread", BenchSeqRead },
+    { "randwrite", BenchRandWrite },
+    { "randread", BenchRandRead },
+    { "storm", BenchStorm },
+    { "metadata", BenchMetadata },
+    { "concurrent", BenchConcurrent },
+};
+
+void
+Benchmark(const char *which)
+{
+    bool found = false;
+
+    for (unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	if (!strcmp(which, "all") || !strcmp(which, benchmarks[i].name)) {
+	    (*benchmarks[i].run)();
+	    found = true;
+	}
+    if (!found)
+	printf("Benchmark: unknown workload %s\n", which);
+}
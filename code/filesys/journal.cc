@@ -0,0 +1,265 @@
+// journal.cc
+//	Routines to manage the write-ahead log of file system metadata.
+//	See journal.h for the overall design.
+//
+//	Commit protocol:
+//	   1. write every captured sector to consecutive log sectors
+//	   2. write the commit record (this is the commit point)
+//	   3. write every captured sector to its home location
+//	   4. clear the commit record
+//
+//	A crash before step 2 loses the group, but leaves the old metadata
+//	intact; a crash after step 2 is repaired by Recover.
+//
+//	Transactions are run by the file system operations that change
+//	metadata, which hold the file system lock exclusively, so only one
+//	is open at a time.  Other threads may still write file data (through
+//	OpenFile, which does not take that lock) while a transaction is
+//	open; those writes are not the owner's and go straight to disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "system.h"
+
+// Marks a sector as holding a commit record.
+#define JournalMagic 	0x4a4e4c31
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal, bringing the header of the log file into
+//	memory.  Nothing is captured until the first Begin.
+//
+//	"sector" -- the location on disk of the file header for the log
+//----------------------------------------------------------------------
+
+Journal::Journal(int sector)
+{
+    hdr = new FileHeader;
+    hdr->FetchFrom(sector);
+    depth = 0;
+    owner = NULL;
+    numPending = 0;
+    numInstalled = 0;
+    data = new char[NumLogSectors * SectorSize];
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Commit whatever is still pending, and de-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    Commit();
+    delete [] data;
+    delete hdr;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteCommitRecord
+// 	Write the commit record to the first sector of the log file,
+//	listing the home location of the first "numEntries" captured
+//	sectors.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteCommitRecord(int numEntries)
+{
+    char buf[SectorSize];
+    CommitRecord *record = (CommitRecord *) buf;
+
+    bzero(buf, SectorSize);
+    record->magic = JournalMagic;
+    record->numEntries = numEntries;
+    for (int i = 0; i < numEntries; i++)
+	record->homeSector[i] = homeSector[i];
+    synchDisk->WriteSectorInPlace(hdr->ByteToSector(0), buf);
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Initialize the log of a freshly formatted disk to be empty.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    WriteCommitRecord(0);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Called when the disk is mounted.  If the commit record says there
+//	is a committed group that may not have been installed, copy each
+//	logged sector to its home location, then clear the commit record.
+//	Installing a sector twice does no harm.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    char buf[SectorSize];
+    char sectorData[SectorSize];
+    CommitRecord *record = (CommitRecord *) buf;
+
+    synchDisk->ReadSectorInPlace(hdr->ByteToSector(0), buf);
+    if ((record->magic != JournalMagic) || (record->numEntries == 0))
+	return;				// nothing to replay
+
+    DEBUG('f', "Replaying %d logged sectors.\n", record->numEntries);
+    ASSERT(record->numEntries <= NumLogSectors);
+    for (int i = 0; i < record->numEntries; i++) {
+	synchDisk->ReadSectorInPlace(hdr->ByteToSector((i + 1) * SectorSize),
+					sectorData);
+	synchDisk->WriteSectorInPlace(record->homeSector[i], sectorData);
+    }
+    WriteCommitRecord(0);
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a transaction.  Until the matching End, sector writes are
+//	captured by the journal.  If the transaction might not fit in
+//	what is left of the log, commit the group collected so far first.
+//
+//	Transactions can be nested; only the outermost one counts.  Only
+//	one thread at a time can be in a transaction: the file system must
+//	not run two metadata operations at once.
+//
+//	"maxSectors" -- the most distinct sectors the transaction can write
+//----------------------------------------------------------------------
+
+void
+Journal::Begin(int maxSectors)
+{
+    ASSERT(maxSectors <= NumLogSectors);
+    ASSERT((depth == 0) || (owner == currentThread));
+    if ((depth == 0) && (numPending + maxSectors > NumLogSectors))
+	Commit();
+    owner = currentThread;
+    depth++;
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish a transaction.  Its sectors stay in memory, and will be
+//	committed together with later transactions.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    ASSERT((depth > 0) && (owner == currentThread));
+    if (--depth == 0)
+	owner = NULL;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit every completed transaction to the log, and then install
+//	the logged sectors in their home locations.  The log sectors are
+//	consecutive, so step 1 is a single sequential sweep of the disk.
+//
+//	Each install waits for the disk, and meanwhile another thread may
+//	write a captured sector; "numInstalled" tells Log which ones are
+//	already (being) written home, so that those writes also go to
+//	disk instead of only to a copy we are about to forget.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    int i;
+
+    ASSERT(depth == 0);			// no transaction in progress
+    if (numPending == 0)
+	return;
+
+    DEBUG('f', "Committing %d metadata sectors.\n", numPending);
+    for (i = 0; i < numPending; i++)
+	synchDisk->WriteSectorInPlace(hdr->ByteToSector((i + 1) * SectorSize),
+					&data[i * SectorSize]);
+    WriteCommitRecord(numPending);	// commit point
+
+    for (i = 0; i < numPending; i++) {
+	numInstalled = i + 1;
+	synchDisk->WriteSectorInPlace(homeSector[i], &data[i * SectorSize]);
+    }
+    WriteCommitRecord(0);
+    numPending = 0;
+    numInstalled = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::Find
+// 	Return the index of "sector" among the captured sectors, or -1.
+//----------------------------------------------------------------------
+
+int
+Journal::Find(int sector)
+{
+    for (int i = 0; i < numPending; i++)
+	if (homeSector[i] == sector)
+	    return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Called by the SynchDisk for every sector write.  Inside a
+//	transaction, capture the new contents, if the write comes from the
+//	thread running it; writes by any other thread (file data, while
+//	the transaction is blocked on the disk) are not metadata, and must
+//	not use up the room Begin reserved.  In any case, a sector that is
+//	already captured must be updated here, otherwise the (older)
+//	captured copy would overwrite it when the group is installed.
+//	If Commit already installed it, the captured copy is updated but
+//	the write must go to disk as well.
+//
+//	Return true if the write was captured, false if the caller
+//	should write the sector to disk itself.
+//
+//	"sector" -- the sector being written
+//	"from" -- the new contents of the sector
+//----------------------------------------------------------------------
+
+bool
+Journal::Log(int sector, const char *from)
+{
+    int i = Find(sector);
+
+    if (i == -1) {
+	if ((depth == 0) || (owner != currentThread))
+	    return false;		// not metadata, write it in place
+	ASSERT(numPending < NumLogSectors);	// Begin reserved room for it
+	i = numPending++;
+	homeSector[i] = sector;
+    }
+    bcopy(from, &data[i * SectorSize], SectorSize);
+    return (i >= numInstalled);
+}
+
+//----------------------------------------------------------------------
+// Journal::Lookup
+// 	Called by the SynchDisk for every sector read.  If the sector is
+//	captured, return the captured copy, which is newer than the one
+//	on disk.
+//
+//	"sector" -- the sector being read
+//	"into" -- the buffer to hold the contents of the sector
+//----------------------------------------------------------------------
+
+bool
+Journal::Lookup(int sector, char *into)
+{
+    int i = Find(sector);
+
+    if (i == -1)
+	return false;
+    bcopy(&data[i * SectorSize], into, SectorSize);
+    return true;
+}
@@ -0,0 +1,104 @@
+// journal.h
+//	Data structures for a write-ahead log of file system metadata.
+//
+//	Operations that modify the file system metadata (the free sector
+//	bitmap, the directory and the file headers) are bracketed by
+//	Begin/End.  While a transaction is open, every sector written
+//	through the SynchDisk by the thread that began it is captured in
+//	memory by the journal instead of going to its home location on
+//	disk; reads see the captured copy.  Writes by other threads (e.g.,
+//	file data written while the transaction waits for the disk) are
+//	not part of the transaction, and go to disk as usual.
+//
+//	Completed transactions are grouped together and committed as a
+//	single sequential write to the log area, followed by a commit
+//	record.  Only then are the sectors written to their home locations
+//	("installed"), and the commit record cleared.  If Nachos stops
+//	after the commit record is written, but before the install is
+//	finished, the log is replayed the next time the disk is mounted.
+//
+//	Since the same directory and bitmap sectors are rewritten by
+//	almost every operation, grouping many operations into one commit
+//	turns a large number of scattered metadata writes into one
+//	sequential log write plus one install per distinct sector.
+//
+//	The log is itself stored as a normal Nachos file, whose header is
+//	in a well-known sector (see filesys.cc).  The first data sector of
+//	the file holds the commit record; the rest hold logged sectors.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "filehdr.h"
+
+class Thread;
+
+// Maximum number of distinct sectors the log can hold; limited by the
+// number of data sectors a file header can point to (one of which is
+// used for the commit record).
+#define NumLogSectors 		((int) NumDirect - 1)
+#define JournalFileSize 	((NumLogSectors + 1) * SectorSize)
+
+// The following class defines the on-disk commit record.  It is stored
+// in a single sector.  "numEntries" is zero when there is nothing to
+// replay.
+
+class CommitRecord {
+  public:
+    int magic;				// JournalMagic if this is a log
+    int numEntries;			// number of sectors in the log
+    int homeSector[NumLogSectors];	// where each logged sector belongs
+};
+
+// The following class defines the metadata journal.
+
+class Journal {
+  public:
+    Journal(int sector);		// Open the log, whose file header
+					// is at "sector"
+    ~Journal();				// Commit anything pending, and
+					// de-allocate the journal
+
+    void Format();			// Write an empty commit record
+    void Recover();			// Replay a committed, but not
+					// installed, log (called on mount)
+
+    void Begin(int maxSectors);		// Start a transaction that may
+					// write up to "maxSectors" sectors
+    void End();				// Transaction finished; it will be
+					// committed with the next group
+
+    void Commit();			// Write every completed transaction
+					// to the log, then install them
+
+    bool Log(int sector, const char *data);
+					// Capture a sector write.  Return
+					// false if it should go straight
+					// to disk
+    bool Lookup(int sector, char *data);// Return the captured copy of
+					// "sector", if there is one
+
+  private:
+    FileHeader *hdr;			// Header of the log file
+    int depth;				// Nesting depth of Begin/End
+    Thread *owner;			// Thread running the transaction
+    int numPending;			// Number of captured sectors
+    int homeSector[NumLogSectors];	// Home location of each one
+    char *data;				// Contents of each one
+    int numInstalled;			// How many of them Commit has
+					// started to install (0 if it is
+					// not installing)
+
+    int Find(int sector);		// Index of "sector" in the captured
+					// set, -1 if it is not there
+    void WriteCommitRecord(int numEntries);
+};
+
+#endif // JOURNAL_H
@@ -92,16 +92,20 @@ OpenFile::Write(const char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  Sectors that are completely covered by the
+//	request are transferred directly to/from the caller's buffer; only
+//	the (at most two) partial sectors at either end of the request go
+//	through a one-sector bounce buffer.  Thus:
 //
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   We read each full sector straight into "into"; for a partial
+//	   sector we read the whole sector into the bounce buffer, and only
+//	   copy the part we are interested in.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   We write each full sector straight from "from"; for a partial
+//	   sector we must first read it into the bounce buffer, so that we
+//	   don't overwrite the unmodified portion, then copy in the data
+//	   that will be modified, and write the sector back.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -114,8 +118,8 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, firstSector, lastSector, start, end;
+    char buf[SectorSize];		// bounce buffer for partial sectors
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -126,17 +130,25 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    for (i = firstSector; i <= lastSector; i++) {
+    // the part of sector i that belongs to the request: [start, end)
+	start = i * SectorSize;
+	if (start < position)
+	    start = position;
+	end = (i + 1) * SectorSize;
+	if (end > position + numBytes)
+	    end = position + numBytes;
+
+	if ((end - start) == SectorSize)	// full sector, no copy needed
+	    synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+					&into[start - position]);
+	else {					// partial sector, bounce it
+	    synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), buf);
+	    bcopy(&buf[start - (i * SectorSize)], &into[start - position], 
+					end - start);
+	}
+    }
     return numBytes;
 }
 
@@ -144,9 +156,8 @@ int
 OpenFile::WriteAt(const char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int i, firstSector, lastSector, start, end;
+    char buf[SectorSize];		// bounce buffer for partial sectors
 
     if ((numBytes <= 0) || (position >= fileLength))
 	return 0;				// check request
@@ -157,28 +168,26 @@ OpenFile::WriteAt(const char *from, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
-
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
+    for (i = firstSector; i <= lastSector; i++) {
+    // the part of sector i that belongs to the request: [start, end)
+	start = i * SectorSize;
+	if (start < position)
+	    start = position;
+	end = (i + 1) * SectorSize;
+	if (end > position + numBytes)
+	    end = position + numBytes;
+
+	if ((end - start) == SectorSize)	// full sector, no copy needed
+	    synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
+					&from[start - position]);
+	else {				// partial sector, read-modify-write
+	    synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), buf);
+	    bcopy(&from[start - position], &buf[start - (i * SectorSize)], 
+					end - start);
+	    synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), buf);
+	}
+    }
     return numBytes;
 }
 
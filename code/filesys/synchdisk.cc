@@ -8,7 +8,9 @@
 //	Use a semaphore to synchronize the interrupt handlers with the
 //	pending requests.  And, because the physical disk can only
 //	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	exclusion.  A disk with several channels can handle one operation
+//	at a time on each of them, so there is a lock and a semaphore
+//	per channel.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +18,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -42,9 +45,14 @@ DiskRequestDone (void* arg)
 
 SynchDisk::SynchDisk(const char* name)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
     disk = new Disk(name, DiskRequestDone, this);
+    semaphore = new Semaphore *[disk->NumChannels()];
+    lock = new Lock *[disk->NumChannels()];
+    for (int i = 0; i < disk->NumChannels(); i++) {
+	semaphore[i] = new Semaphore("synch disk", 0);
+	lock[i] = new Lock("synch disk lock");
+    }
+    journal = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -55,15 +63,20 @@ SynchDisk::SynchDisk(const char* name)
 
 SynchDisk::~SynchDisk()
 {
+    for (int i = 0; i < disk->NumChannels(); i++) {
+	delete lock[i];
+	delete semaphore[i];
+    }
+    delete [] lock;
+    delete [] semaphore;
     delete disk;
-    delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read.  If the journal holds a newer copy
+//	of the sector, return that one instead.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -72,16 +85,27 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
+    if ((journal != NULL) && journal->Lookup(sectorNumber, data))
+	return;
+    ReadSectorInPlace(sectorNumber, data);
+}
+
+void
+SynchDisk::ReadSectorInPlace(int sectorNumber, char* data)
+{
+    int channel = disk->Channel(sectorNumber);
+
+    lock[channel]->Acquire();		// only one disk I/O at a time
     disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    semaphore[channel]->P();		// wait for interrupt
+    lock[channel]->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+//	after the data has been written, or captured by the journal
+//	(inside a metadata transaction).
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +114,30 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, const char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
+    if ((journal != NULL) && journal->Log(sectorNumber, data))
+	return;
+    WriteSectorInPlace(sectorNumber, data);
+}
+
+void
+SynchDisk::WriteSectorInPlace(int sectorNumber, const char* data)
+{
+    int channel = disk->Channel(sectorNumber);
+
+    lock[channel]->Acquire();		// only one disk I/O at a time
     disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    semaphore[channel]->P();		// wait for interrupt
+    lock[channel]->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the request
+//	on the channel that just finished.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    semaphore[disk->DoneChannel()]->V();
 }
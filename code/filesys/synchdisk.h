@@ -14,16 +14,23 @@
 #include "disk.h"
 #include "synch.h"
 
+class Journal;
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
 // and an interrupt occurs later to signal that the operation completed.
 // (Also, the physical characteristics of the disk device assume that
-// only one operation can be requested at a time).
+// only one operation can be requested at a time on each of its channels;
+// a normal disk has a single channel).
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// If a metadata journal is attached, ReadSector and WriteSector go
+// through it first (cf. journal.h); the "InPlace" versions always go
+// straight to the disk.
 class SynchDisk {
   public:
     SynchDisk(const char* name);    	// Initialize a synchronous disk,
@@ -37,6 +44,12 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, const char* data);
+
+    void ReadSectorInPlace(int sectorNumber, char* data);
+    void WriteSectorInPlace(int sectorNumber, const char* data);
+					// Same, but bypassing the journal
+    void SetJournal(Journal *j) { journal = j; }
+					// Route requests through "j"
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -44,10 +57,13 @@ class SynchDisk {
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    Semaphore **semaphore; 		// To synchronize requesting thread 
+					// with the interrupt handler, one
+					// per disk channel
+    Lock **lock;	  		// Only one read/write request
+					// can be sent to each disk channel
+					// at a time
+    Journal *journal;			// Metadata journal, NULL if none
 };
 
 #endif // SYNCHDISK_H
@@ -56,8 +56,14 @@ Console::Console(const char *readFile, const char *writeFile,
     putBusy = false;
     incoming = EOF;
 
-    // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, this, ConsoleTime, ConsoleReadInt);
+    // start polling for incoming packets; when replaying a trace, the
+    // input comes from the trace, so there is no file to wait for
+    if ((trace != NULL) && trace->Replaying())
+	pollEvent = interrupt->SchedulePeriodic(ConsoleReadPoll, this, 
+			ConsoleTime, ConsoleReadInt);
+    else
+	pollEvent = interrupt->SchedulePoll(ConsoleReadPoll, this, 
+			ConsoleTime, ConsoleReadInt, readFileNo);
 }
 
 //----------------------------------------------------------------------
@@ -67,6 +73,7 @@ Console::Console(const char *readFile, const char *writeFile,
 
 Console::~Console()
 {
+    interrupt->Cancel(pollEvent);
     if (readFileNo != 0)
 	Close(readFileNo);
     if (writeFileNo != 1)
@@ -82,6 +89,9 @@ Console::~Console()
 //	character has been grabbed out of the buffer by the Nachos kernel).
 //	Invoke the "read" interrupt handler, once the character has been 
 //	put into the buffer. 
+//
+//	When replaying a trace, the characters come from the trace, at
+//	the same times as they were read when it was recorded.
 //----------------------------------------------------------------------
 
 void
@@ -89,16 +99,21 @@ Console::CheckCharAvail()
 {
     char c;
 
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, this, ConsoleTime, 
-			ConsoleReadInt);
-
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-	return;	  
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
+    // do nothing if character is already buffered
+    if (incoming != EOF)
+	return;
+    if ((trace != NULL) && trace->Replaying()) {
+	if (!trace->ReplayInput(&c))
+	    return;
+    } else {
+	if (!PollFile(readFileNo))	// or none to be read
+	    return;	  
+	Read(readFileNo, &c, sizeof(char));
+	if (trace != NULL)
+	    trace->Record(TraceInput, 0, c);
+    }
+
+    // otherwise, tell user about it
     incoming = c ;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);	
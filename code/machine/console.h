@@ -71,6 +71,8 @@ class Console {
     char incoming;    			// Contains the character to be read,
 					// if there is one available. 
 					// Otherwise contains EOF.
+    int pollEvent;			// Periodic interrupt that polls
+					// the keyboard
 };
 
 #endif // CONSOLE_H
@@ -25,8 +25,58 @@
 
 #define DiskSize 	(MagicSize + (NumSectors * SectorSize))
 
+// The disk geometry and timing model; see SetDiskGeometry and SetDiskModel.
+int SectorsPerTrack = 32;
+int NumTracks = 32;
+int NumSectors = SectorsPerTrack * NumTracks;
+
+static DiskModel diskModel = RotatingDisk;
+static int diskChannels = 1;
+
 // dummy procedure because we can't take a pointer of a member function
-static void DiskDone(void* arg) { ((Disk *)arg)->HandleInterrupt(); }
+static void DiskDone(void* arg) 
+{ 
+    Disk::ChannelDone *done = (Disk::ChannelDone *) arg;
+
+    done->disk->HandleInterrupt(done->channel); 
+}
+
+//----------------------------------------------------------------------
+// SetDiskGeometry
+// 	Change the number of tracks and the number of sectors per track
+//	of the simulated disk.  Must be called before the disk is created.
+//
+//	A disk file created with a different geometry cannot be used;
+//	remove it, and format the new disk.
+//----------------------------------------------------------------------
+
+void
+SetDiskGeometry(int tracks, int sectorsPerTrack)
+{
+    ASSERT((tracks > 0) && (sectorsPerTrack > 0));
+    NumTracks = tracks;
+    SectorsPerTrack = sectorsPerTrack;
+    NumSectors = SectorsPerTrack * NumTracks;
+}
+
+//----------------------------------------------------------------------
+// SetDiskModel
+// 	Change the timing model of the simulated disk.  Must be called
+//	before the disk is created.
+//
+//	"model" -- how to compute the latency of each request (cf. disk.h)
+//	"numChannels" -- requests the disk can serve at the same time; 
+//	   only a SolidStateDisk can have more than one
+//----------------------------------------------------------------------
+
+void
+SetDiskModel(DiskModel model, int numChannels)
+{
+    ASSERT((numChannels > 0) && (numChannels <= MaxDiskChannels));
+    ASSERT((model == SolidStateDisk) || (numChannels == 1));
+    diskModel = model;
+    diskChannels = numChannels;
+}
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -50,11 +100,15 @@ Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg)
     handlerArg = callArg;
     lastSector = 0;
     bufferInit = 0;
+    model = diskModel;
+    numChannels = diskChannels;
     
     fileno = OpenForReadWrite(name, false);
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
 	ASSERT(magicNum == MagicNumber);
+	Lseek(fileno, 0, 2);		// and that it has the same geometry
+	ASSERT(Tell(fileno) == (int) DiskSize);
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(name);
 	magicNum = MagicNumber;  
@@ -64,7 +118,11 @@ Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, void* callArg)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
-    active = false;
+    for (int i = 0; i < numChannels; i++) {
+	active[i] = false;
+	done[i].disk = this;
+	done[i].channel = i;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -117,8 +175,8 @@ Disk::ReadRequest(int sectorNumber, char* data)
 {
     int ticks = ComputeLatency(sectorNumber, false);
 
-    ASSERT(!active);				// only one request at a time
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT(!active[Channel(sectorNumber)]);	// only one request at a time
     
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
@@ -126,10 +184,10 @@ Disk::ReadRequest(int sectorNumber, char* data)
     if (DebugIsEnabled('d'))
 	PrintSector(false, sectorNumber, data);
     
-    active = true;
-    UpdateLast(sectorNumber);
     stats->numDiskReads++;
-    interrupt->Schedule(DiskDone, this, ticks, DiskInt);
+    if (trace != NULL)
+	trace->Record(TraceDisk, 0, sectorNumber);
+    StartRequest(sectorNumber, ticks);
 }
 
 void
@@ -137,8 +195,8 @@ Disk::WriteRequest(int sectorNumber, const char* data)
 {
     int ticks = ComputeLatency(sectorNumber, true);
 
-    ASSERT(!active);
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT(!active[Channel(sectorNumber)]);
     
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
@@ -146,22 +204,44 @@ Disk::WriteRequest(int sectorNumber, const char* data)
     if (DebugIsEnabled('d'))
 	PrintSector(true, sectorNumber, data);
     
-    active = true;
-    UpdateLast(sectorNumber);
     stats->numDiskWrites++;
-    interrupt->Schedule(DiskDone, this, ticks, DiskInt);
+    if (trace != NULL)
+	trace->Record(TraceDisk, 1, sectorNumber);
+    StartRequest(sectorNumber, ticks);
+}
+
+//----------------------------------------------------------------------
+// Disk::StartRequest()
+// 	Mark the channel serving "sectorNumber" busy, and arrange for the
+//	interrupt handler to be called when the request is done.
+//
+//	"sectorNumber" -- the disk sector being read/written
+//	"ticks" -- how long the request takes
+//----------------------------------------------------------------------
+
+void
+Disk::StartRequest(int sectorNumber, int ticks)
+{
+    int channel = Channel(sectorNumber);
+
+    active[channel] = true;
+    UpdateLast(sectorNumber);
+    interrupt->Schedule(DiskDone, &done[channel], ticks, DiskInt);
 }
 
 //----------------------------------------------------------------------
 // Disk::HandleInterrupt()
 // 	Called when it is time to invoke the disk interrupt handler,
 //	to tell the Nachos kernel that the disk request is done.
+//
+//	"channel" -- the channel that served the request
 //----------------------------------------------------------------------
 
 void
-Disk::HandleInterrupt ()
+Disk::HandleInterrupt (int channel)
 { 
-    active = false;
+    active[channel] = false;
+    doneChannel = channel;
     (*handler)(handlerArg);
 }
 
@@ -227,11 +307,22 @@ Disk::ModuloDiff(int to, int from)
 //   	read requests to the current track to be satisfied more quickly.
 //   	The contents of the track buffer are discarded after every seek to 
 //   	a new track.
+//
+//	The InstantDisk and SolidStateDisk models skip all of this, and
+//	use a constant latency instead.
 //----------------------------------------------------------------------
 
 int
 Disk::ComputeLatency(int newSector, bool writing)
 {
+    if (model == InstantDisk) {
+	DEBUG('d', "Request latency = %d\n", 1);
+	return 1;			// the interrupt can't come any sooner
+    } else if (model == SolidStateDisk) {
+	DEBUG('d', "Request latency = %d\n", FlashTime);
+	return FlashTime;
+    }
+
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
     int timeAfter = stats->totalTicks + seek + rotation;
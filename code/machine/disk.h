@@ -45,12 +45,35 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The number of tracks and sectors per track can be chosen when Nachos
+// starts (see SetDiskGeometry), and so can the timing model:
+//
+//   RotatingDisk -- the model described above (the default)
+//   InstantDisk -- every request takes a single tick; useful to run
+//	functional tests quickly, when disk timing is not of interest
+//   SolidStateDisk -- no seek or rotational delay; every request takes
+//	FlashTime ticks (cf. stats.h).  Sectors are striped across
+//	"numChannels" independent channels, each of which can serve a
+//	request at the same time as the others.
+//
+// The sector size is fixed: the page size and the on-disk data
+// structures of the file system are laid out in sectors.
 
 const int SectorSize = 128;	// number of bytes per disk sector
-const int SectorsPerTrack = 32;	// number of sectors per disk track 
-const int NumTracks = 32;	// number of tracks per disk
-const int NumSectors = SectorsPerTrack * NumTracks;
-					// total # of sectors per disk
+extern int SectorsPerTrack;	// number of sectors per disk track 
+extern int NumTracks;		// number of tracks per disk
+extern int NumSectors;		// total # of sectors per disk
+
+enum DiskModel { RotatingDisk, InstantDisk, SolidStateDisk };
+
+const int MaxDiskChannels = 16;	// most channels a solid state disk can have
+
+extern void SetDiskGeometry(int tracks, int sectorsPerTrack);
+					// Change the disk geometry; must be
+					// called before the disk is created
+extern void SetDiskModel(DiskModel model, int numChannels);
+					// Change the timing model; ditto
 
 class Disk {
   public:
@@ -64,10 +87,18 @@ class Disk {
     					// Read/write an single disk sector.
 					// These routines send a request to 
     					// the disk and return immediately.
-    					// Only one request allowed at a time!
+    					// Only one request allowed at a time
+					// on each channel!
     void WriteRequest(int sectorNumber, const char* data);
 
-    void HandleInterrupt();		// Interrupt handler, invoked when
+    int NumChannels() { return numChannels; }
+    int Channel(int sectorNumber) { return sectorNumber % numChannels; }
+					// Channel that serves "sectorNumber"
+    int DoneChannel() { return doneChannel; }
+					// Channel whose request just finished;
+					// only valid inside the handler
+
+    void HandleInterrupt(int channel);	// Interrupt handler, invoked when
 					// disk request finishes.
 
     int ComputeLatency(int newSector, bool writing);	
@@ -75,12 +106,22 @@ class Disk {
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
 
+    struct ChannelDone {		// Argument of the interrupt raised
+	Disk *disk;			// when a channel finishes
+	int channel;
+    };
+
   private:
     int fileno;				// UNIX file number for simulated disk 
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     void* handlerArg;			// Argument to interrupt handler 
-    bool active;     			// Is a disk operation in progress?
+    DiskModel model;			// Timing model
+    int numChannels;			// 1, unless model is SolidStateDisk
+    bool active[MaxDiskChannels];	// Is a disk operation in progress
+					// on each channel?
+    int doneChannel;			// Channel being reported to handler
+    ChannelDone done[MaxDiskChannels];	// Interrupt argument, per channel
     int lastSector;			// The previous disk request 
     int bufferInit;			// When the track buffer started 
 					// being loaded
@@ -88,6 +129,8 @@ class Disk {
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void StartRequest(int sectorNumber, int ticks);
+					// Common part of Read/WriteRequest
 };
 
 #endif // DISK_H
@@ -28,7 +28,8 @@
 
 static const char *intLevelNames[] = { "off", "on"};
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
-				      "console read", "network send", "network recv"};
+				      "console read", "network send", "network recv",
+				      "alarm"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -48,6 +49,13 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void* param, int time,
     arg = param;
     when = time;
     type = kind;
+    period = 0;
+    id = 0;
+    fd = -1;
+    order = 0;
+    heapIndex = -1;
+    nextById = NULL;
+    next = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +68,17 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void* param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List<PendingInterrupt*>;
+    maxPending = 16;
+    pending = new PendingInterrupt *[maxPending];
+    byId = new PendingInterrupt *[maxPending];
+    for (int i = 0; i < maxPending; i++)
+	byId[i] = NULL;
+    polls = new PendingInterrupt *[maxPending];
+    pollFds = new int[maxPending];
+    numPending = 0;
+    numScheduled = 0;
+    lastId = 0;
+    freeList = NULL;
     inHandler = false;
     yieldOnReturn = false;
     status = SystemMode;
@@ -73,9 +91,18 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete pending->Remove();
-    delete pending;
+    for (int i = 0; i < numPending; i++)
+	delete pending[i];
+    delete [] pending;
+    delete [] byId;
+    delete [] polls;
+    delete [] pollFds;
+    while (freeList != NULL) {
+	PendingInterrupt *p = freeList;
+
+	freeList = p->next;
+	delete p;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -173,7 +200,7 @@ Interrupt::OneTick()
 					// for a context switch, ok to do it now
 	yieldOnReturn = false;
  	status = SystemMode;		// yield is a kernel routine
-	currentThread->Yield();
+	scheduler->Preempt();		// i.e., currentThread->Yield()
 	status = old;
     }
 }
@@ -204,20 +231,29 @@ Interrupt::YieldOnReturn()
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
 //
+//	Devices that poll for input from the host (the console and the
+//	network) are not run every time while idle; see SkipPolls.
+//
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
 //----------------------------------------------------------------------
 void
 Interrupt::Idle()
 {
+    int activity = stats->hostActivity;		// for the host profiler
+    const char *label = stats->hostLabel;
+
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+    SetHostActivity(HostIdle, "idle");
+    SkipPolls();
     if (CheckIfDue(true)) {		// check for any pending interrupts
     	while (CheckIfDue(false))	// check for any other pending 
 	    ;				// interrupts
         yieldOnReturn = false;		// since there's nothing in the
 					// ready queue, the yield is automatic
         status = SystemMode;
+	SetHostActivity(activity, label);
 	return;				// return in case there's now
 					// a runnable thread
     }
@@ -233,6 +269,59 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// Interrupt::SkipPolls
+// 	Called while idle, before advancing the clock.  Polling the host
+//	files over and over again would find nothing new, so instead
+//	check all of them at once:
+//
+//	  - if there is input, do nothing; the next poll will find it
+//	  - otherwise, if some other device has an interrupt pending, 
+//	    move the polls past it, so that the clock advances straight
+//	    to that interrupt
+//	  - otherwise, nothing can happen until there is input, so wait
+//	    for it, without using the host's CPU
+//
+//	The timer does not count as another device: it interrupts
+//	forever, but does nothing while there are no threads to run.
+//
+//	The polls and their files are gathered in arrays that grow with
+//	the heap, so that idling does not allocate memory every time.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SkipPolls()
+{
+    int numFds = 0;
+    int next = -1;		// the next interrupt that is not a poll
+    int i;
+
+    for (i = 0; i < numPending; i++)
+	if (pending[i]->fd >= 0) {
+	    polls[numFds] = pending[i];
+	    pollFds[numFds++] = pending[i]->fd;
+	} else if ((pending[i]->type != TimerInt) 
+			&& ((next == -1) || Earlier(i, next)))
+	    next = i;
+
+    if ((numFds > 0) && !WaitForInput(pollFds, numFds, next == -1)
+			&& (next != -1)) {
+	int until = pending[next]->when;
+
+	DEBUG('i', "No input; skipping polls until time %d\n", until);
+	for (int j = 0; j < numFds; j++) {
+	    PendingInterrupt *p = polls[j];
+
+	    if (p->when >= until)
+		continue;
+	    RemoveAt(p->heapIndex);	// as if it had fired, each time
+	    p->when += ((until - p->when + p->period - 1) / p->period)
+				* p->period;
+	    Insert(p);
+	}
+    }
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
@@ -241,7 +330,15 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    if (currentThread->getStatus() == RUNNING)
+	scheduler->Charge(currentThread);	// bring its CPU time up to date
     stats->Print();
+    scheduler->PrintShares();
+#ifdef USER_PROGRAM
+    PrintUserProfiles();
+#endif
+    if (statsFile != NULL)
+	stats->DumpJSON(statsFile);
     Cleanup();     // Never returns.
 }
 
@@ -250,28 +347,260 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it in a heap ordered by the time it is
+//	to occur (and, for the same time, by the order of the calls), 
+//	reusing the record of an interrupt that already fired, if any.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
 //
+//	Returns a handle that can be passed to Cancel.  Handles are
+//	never zero, so zero can be used to mean "no interrupt".
+//
 //	"handler" is the procedure to call when the interrupt occurs
 //	"arg" is the argument to pass to the procedure
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void
+int
 Interrupt::Schedule(VoidFunctionPtr handler, void* arg, int fromNow, IntType type)
+{
+    return Add(handler, arg, fromNow, type, 0, -1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SchedulePeriodic
+// 	Like Schedule, but the interrupt occurs every "period" ticks from
+//	now on, using the same record (and handle), until it is cancelled.
+//----------------------------------------------------------------------
+
+int
+Interrupt::SchedulePeriodic(VoidFunctionPtr handler, void* arg, int period,
+				IntType type)
+{
+    return Add(handler, arg, period, type, period, -1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SchedulePoll
+// 	Like SchedulePeriodic, for a device that polls the host file "fd"
+//	to find out whether there is input.  While the machine is idle,
+//	the polls are skipped if there is no input, instead of running
+//	every one of them (cf. Idle).
+//----------------------------------------------------------------------
+
+int
+Interrupt::SchedulePoll(VoidFunctionPtr handler, void* arg, int period,
+				IntType type, int fd)
+{
+    ASSERT(fd >= 0);
+    return Add(handler, arg, period, type, period, fd);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Add
+// 	Schedule an interrupt "fromNow" ticks in the future, that then 
+//	repeats every "period" ticks (if "period" is not zero), polling
+//	host file "pollFd" (if it is not -1).  Return its handle.
+//----------------------------------------------------------------------
+
+int
+Interrupt::Add(VoidFunctionPtr handler, void* arg, int fromNow, IntType type,
+		int period, int pollFd)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    PendingInterrupt *toOccur;
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    if (freeList != NULL) {
+	toOccur = freeList;
+	freeList = toOccur->next;
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    } else
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    toOccur->period = period;
+    toOccur->fd = pollFd;
+    if (++lastId <= 0)			// wrapped around
+	lastId = 1;
+    toOccur->id = lastId;
+    Insert(toOccur);			// (may grow "byId")
+    toOccur->nextById = byId[lastId % maxPending];
+    byId[lastId % maxPending] = toOccur;
+    return toOccur->id;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Take back an interrupt that was scheduled, and has not occurred
+//	yet.  A periodic interrupt can be cancelled at any time, even from
+//	its own handler.  The handle leads to the record through "byId",
+//	and the record knows its place in the heap.
+//
+// Returns:
+//	true, if the interrupt was still pending
+// Params:
+//	"id" -- the handle returned by Schedule or SchedulePeriodic
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Cancel(int id)
+{
+    PendingInterrupt *p = Unhash(id);
+
+    if (p == NULL)
+	return false;
+    DEBUG('i', "Cancelling interrupt handler the %s at time = %d\n",
+					intTypeNames[p->type], p->when);
+    RemoveAt(p->heapIndex);
+    p->next = freeList;
+    freeList = p;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Unhash
+// 	Take the interrupt with handle "id" out of the table of scheduled
+//	interrupts, and return it; NULL if it is not there (it already
+//	fired, or was cancelled).  Handles are consecutive, so each bucket
+//	holds about one interrupt.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+Interrupt::Unhash(int id)
+{
+    PendingInterrupt **p = &byId[id % maxPending];
+    PendingInterrupt *found;
+
+    while ((*p != NULL) && ((*p)->id != id))
+	p = &(*p)->nextById;
+    found = *p;
+    if (found != NULL) {
+	*p = found->nextById;
+	found->nextById = NULL;
+    }
+    return found;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Earlier
+// 	Return true if the interrupt in position "i" of the heap is to
+//	fire before the one in position "j".
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Earlier(int i, int j)
+{
+    if (pending[i]->when != pending[j]->when)
+	return pending[i]->when < pending[j]->when;
+    return (int) (pending[i]->order - pending[j]->order) < 0;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Swap
+// 	Exchange the interrupts in positions "i" and "j" of the heap.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Swap(int i, int j)
+{
+    PendingInterrupt *tmp = pending[i];
+
+    pending[i] = pending[j];
+    pending[j] = tmp;
+    pending[i]->heapIndex = i;
+    pending[j]->heapIndex = j;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Insert
+// 	Put an interrupt in the heap, growing it if needed (and the table
+//	of scheduled interrupts and the room for polls with it).  It gets a new place in the
+//	order of interrupts due at the same time.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Insert(PendingInterrupt *p)
+{
+    if (numPending == maxPending) {		// out of room, grow the heap
+	PendingInterrupt **bigger = new PendingInterrupt *[2 * maxPending];
+	PendingInterrupt **oldById = byId;
+	int i;
+
+	for (i = 0; i < numPending; i++)
+	    bigger[i] = pending[i];
+	delete [] pending;
+	pending = bigger;
+	byId = new PendingInterrupt *[2 * maxPending];
+	for (i = 0; i < 2 * maxPending; i++)
+	    byId[i] = NULL;
+	for (i = 0; i < maxPending; i++)	// re-hash the old buckets
+	    while (oldById[i] != NULL) {
+		PendingInterrupt *q = oldById[i];
+
+		oldById[i] = q->nextById;
+		q->nextById = byId[q->id % (2 * maxPending)];
+		byId[q->id % (2 * maxPending)] = q;
+	    }
+	delete [] oldById;
+	delete [] polls;
+	delete [] pollFds;
+	polls = new PendingInterrupt *[2 * maxPending];
+	pollFds = new int[2 * maxPending];
+	maxPending *= 2;
+    }
+
+    int i = numPending++;			// sift it up from the bottom
+    p->order = numScheduled++;
+    pending[i] = p;
+    p->heapIndex = i;
+    while ((i > 0) && Earlier(i, (i - 1) / 2)) {
+	Swap(i, (i - 1) / 2);
+	i = (i - 1) / 2;
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemoveAt
+// 	Remove the interrupt in position "i" of the heap, and return it.
+//	Position 0 holds the next interrupt to fire.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+Interrupt::RemoveAt(int i)
+{
+    PendingInterrupt *removed = pending[i];
+
+    ASSERT((0 <= i) && (i < numPending));
+    removed->heapIndex = -1;
+    pending[i] = pending[--numPending];
+    if (i == numPending)			// it was the last one
+	return removed;
+    pending[i]->heapIndex = i;
+    while ((i > 0) && Earlier(i, (i - 1) / 2)) {	// sift up...
+	Swap(i, (i - 1) / 2);
+	i = (i - 1) / 2;
+    }
+    for (;;) {					// ...or down
+	int smallest = i;
+	int left = 2 * i + 1, right = 2 * i + 2;
+
+	if ((left < numPending) && Earlier(left, smallest))
+	    smallest = left;
+	if ((right < numPending) && Earlier(right, smallest))
+	    smallest = right;
+	if (smallest == i)
+	    break;
+	Swap(i, smallest);
+	i = smallest;
+    }
+    return removed;
 }
 
 //----------------------------------------------------------------------
@@ -291,47 +620,64 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
+    PendingInterrupt *toOccur;
+    bool periodic;
     int when;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		pending->SortedRemove(&when);
 
-    if (toOccur == NULL)		// no pending interrupts
+    if (numPending == 0)		// no pending interrupts
 	return false;			
+    when = pending[0]->when;		// just look at the first one; it
+					// stays in the heap if not due yet
 
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
+    } else if (when > stats->totalTicks) {	// not time yet
 	return false;
     }
 
 // Check if there is nothing more to do, and if so, quit
-    if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
-	 return false;
-    }
+    if ((status == IdleMode) && (pending[0]->type == TimerInt) 
+				&& (numPending == 1))
+	return false;
 
+    toOccur = RemoveAt(0);
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
+    if ((trace != NULL) && (toOccur->type != ConsoleReadInt) 
+			&& (toOccur->type != NetworkRecvInt))
+	trace->Record(TraceInterrupt, toOccur->type, 0);  // not the polls
+    periodic = (toOccur->period > 0);
+    if (periodic) {				// put it back for next time,
+	toOccur->when += toOccur->period;	// before the handler has a
+	Insert(toOccur);			// chance to cancel it
+    } else
+	Unhash(toOccur->id);			// too late to cancel it
 #ifdef USER_PROGRAM
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
 #endif
+    int activity = stats->hostActivity;		// for the host profiler
+    const char *label = stats->hostLabel;
+
     inHandler = true;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
 						// running in the kernel
+    SetHostActivity(HostInterrupt, intTypeNames[toOccur->type]);
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
+    SetHostActivity(activity, label);
     status = old;				// restore the machine status
     inHandler = false;
-    delete toOccur;
+    if (!periodic) {				// keep the record for reuse
+	toOccur->next = freeList;
+	freeList = toOccur;
+    }
     return true;
 }
 
@@ -351,7 +697,8 @@ PrintPending(PendingInterrupt* pend)
 //----------------------------------------------------------------------
 // DumpState
 // 	Print the complete interrupt state - the status, and all interrupts
-//	that are scheduled to occur in the future.
+//	that are scheduled to occur in the future (in heap order, which
+//	is not necessarily the order in which they will occur).
 //----------------------------------------------------------------------
 
 void
@@ -361,7 +708,8 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Apply(PrintPending);
+    for (int i = 0; i < numPending; i++)
+	PrintPending(pending[i]);
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
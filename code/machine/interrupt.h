@@ -36,7 +36,7 @@
 #define INTERRUPT_H
 
 #include "copyright.h"
-#include "list.h"
+#include "utility.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
@@ -48,9 +48,11 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
+// display and keyboard, and a network.  AlarmInt is used by the kernel
+// to wake up threads sleeping on the alarm clock; unlike the timer,
+// it keeps Nachos running while threads are waiting for it.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, AlarmInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -67,6 +69,17 @@ class PendingInterrupt {
     void* arg;                  // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int period;			// If not zero, the interrupt fires again
+				// every "period" ticks, until cancelled
+    int id;			// Handle returned by Interrupt::Schedule
+    int fd;			// If not -1, the interrupt periodically
+				// polls this host file for input
+    unsigned order;		// Interrupts due at the same time fire
+				// in the order they were scheduled
+    int heapIndex;		// Where it is in the heap, or -1
+    PendingInterrupt *nextById;	// Next one in the same bucket of the
+				// table of scheduled interrupts
+    PendingInterrupt *next;	// Next free record, once it has fired
 };
 
 // The following class defines the data structures for the simulation
@@ -96,6 +109,7 @@ class Interrupt {
 					// from an interrupt handler
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
+    bool InHandler() { return inHandler; } // running an interrupt handler?
     void setStatus(MachineStatus st) { status = st; }
 
     void DumpState();			// Print interrupt state
@@ -106,16 +120,39 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
+    int Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
 	void* arg, int when, IntType type);// at time ``when''.  This is called
     					// by the hardware device simulators.
+					// Returns a handle for Cancel.
+    int SchedulePeriodic(VoidFunctionPtr handler, void* arg, int period,
+	IntType type);			// Same, but the interrupt occurs
+					// every "period" ticks from now on
+    int SchedulePoll(VoidFunctionPtr handler, void* arg, int period,
+	IntType type, int fd);		// Same, for a device that polls the
+					// host file "fd" for input; while
+					// the machine is idle, the polls are
+					// skipped until there is some
+    bool Cancel(int id);		// Cancel a scheduled interrupt, if
+					// it has not fired yet (or is
+					// periodic); return false if not
     
     void OneTick();       		// Advance simulated time
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List<PendingInterrupt*> *pending;	// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt **pending;	// the interrupts scheduled to occur in
+				// the future, as a binary min-heap
+				// ordered by time
+    int numPending;		// how many are in the heap
+    int maxPending;		// room in the heap, before it must grow
+    PendingInterrupt **byId;	// the scheduled interrupts, hashed by
+				// handle into "maxPending" buckets
+    PendingInterrupt **polls;	// room for "maxPending" polls, and
+    int *pollFds;		// their files, for SkipPolls
+    unsigned numScheduled;	// interrupts scheduled so far
+    int lastId;			// handle given to the last interrupt
+    PendingInterrupt *freeList;	// records that have fired, to be
+				// reused by Schedule
     bool inHandler;		// true if we are running an interrupt handler
     bool yieldOnReturn; 	// true if we are to context switch
 				// on return from the interrupt handler
@@ -126,6 +163,17 @@ class Interrupt {
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
 
+    bool Earlier(int i, int j);		// Heap entry "i" should fire
+					// before entry "j"
+    void Swap(int i, int j);		// Exchange two heap entries
+    int Add(VoidFunctionPtr handler, void* arg, int fromNow, IntType type,
+	int period, int fd);		// Schedule and SchedulePeriodic
+    void SkipPolls();			// While idle, wait for host input or
+					// skip the polls that won't find any
+    void Insert(PendingInterrupt *p);	// Put an interrupt in the heap
+    PendingInterrupt *RemoveAt(int i);	// Remove heap entry "i"
+    PendingInterrupt *Unhash(int id);	// Take an interrupt out of "byId"
+
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
 };
@@ -70,8 +70,10 @@ Machine::Machine(bool debug)
     tlb = NULL;
     pageTable = NULL;
 #endif
+    profile = NULL;
 
     singleStep = debug;
+    stats->userPC = &registers[PCReg];	// for the host profiler
     CheckEndian();
 }
 
@@ -106,7 +108,9 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     interrupt->setStatus(SystemMode);
+    SetHostActivity(HostKernel, exceptionNames[which]);
     ExceptionHandler(which);		// interrupts are enabled at this point
+    SetHostActivity(HostUser, NULL);
     interrupt->setStatus(UserMode);
 }
 
@@ -26,6 +26,8 @@
 #include "translate.h"
 #include "disk.h"
 
+class UserProfile;
+
 // Definitions related to the size, and format of user memory
 
 const int PageSize = SectorSize; 	// set the page size equal to
@@ -182,6 +184,9 @@ class Machine {
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    UserProfile *profile;		// if not NULL, count every user
+					// instruction executed in it
+
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
@@ -15,6 +15,7 @@
 #include "machine.h"
 #include "mipssim.h"
 #include "system.h"
+#include "userprof.h"
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
@@ -37,6 +38,7 @@ Machine::Run()
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
     for (;;) {
+	SetHostActivity(HostUser, NULL);
         OneInstruction(instr);
 	interrupt->OneTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
@@ -102,7 +104,11 @@ Machine::OneInstruction(Instruction *instr)
     if (!machine->ReadMem(registers[PCReg], 4, &raw))
 	return;			// exception occurred
     instr->value = raw;
+    SetHostActivity(HostDecode, NULL);
     instr->Decode();
+    SetHostActivity(HostUser, NULL);
+    if (profile != NULL)
+	profile->Count(registers[PCReg], registers[PrevPCReg]);
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[(int)instr->opCode];
@@ -554,6 +560,10 @@ Machine::OneInstruction(Instruction *instr)
     
     // Now we have successfully executed the instruction.
     
+    if (profile != NULL && (instr->opCode == OP_JAL || 
+				instr->opCode == OP_JALR))
+	profile->Call(pcAfter);
+
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
     
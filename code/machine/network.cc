@@ -42,11 +42,13 @@ Network::Network(NetworkAddress addr, double reliability,
 						 // in the current directory.
 
     // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, this, NetworkTime, NetworkRecvInt);
+    pollEvent = interrupt->SchedulePoll(NetworkReadPoll, this, NetworkTime,
+			NetworkRecvInt, sock);
 }
 
 Network::~Network()
 {
+    interrupt->Cancel(pollEvent);
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
@@ -57,9 +59,6 @@ Network::~Network()
 void
 Network::CheckPktAvail()
 {
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, this, NetworkTime, NetworkRecvInt);
-
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
     if (!PollSocket(sock)) 	// do nothing if no packet to be read
@@ -96,6 +96,7 @@ class Network {
 				//   network
     PacketHeader inHdr;		// Information about arrived packet
     char inbox[MaxPacketSize];  // Data for arrived packet
+    int pollEvent;		// Periodic interrupt that polls the socket
 };
 
 #endif // NETWORK_H
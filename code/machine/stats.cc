@@ -11,6 +11,21 @@
 #include "utility.h"
 #include "stats.h"
 
+// Disk timings (cf. stats.h)
+int RotationTime = 500;
+int SeekTime = 500;
+int FlashTime = 50;
+
+// How often the host profiler takes a sample, in microseconds of host
+// CPU time.
+#define ProfileInterval 	1000
+
+static const char *hostActivityNames[] = { "kernel", "user instructions",
+				"address translation", "instruction decoding",
+				"interrupt handlers", "idle" };
+
+static Statistics *profiled;	// whose HostSample to call
+
 //----------------------------------------------------------------------
 // Statistics::Statistics
 // 	Initialize performance metrics to zero, at system startup.
@@ -22,12 +37,177 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numDispatches = readyWaitTicks = 0;
+    numVoluntarySwitches = numInvoluntarySwitches = 0;
+    for (int i = 0; i < LatencyBuckets; i++)
+	readyLatency[i] = 0;
+    numThreadStats = 0;
+    hostStartTime = WallClock();
+    hostActivity = HostKernel;
+    hostLabel = "kernel threads";
+    userPC = NULL;
+    profile = NULL;
+    hostProfiling = false;
+    profileSync = false;
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordReadyLatency
+// 	Add a dispatch to the ready latency histogram.
+//
+//	"ticks" -- how long the thread waited on the ready list
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordReadyLatency(int ticks)
+{
+    int bucket = 0;
+
+    while ((ticks > 0) && (bucket < LatencyBuckets - 1)) {
+	ticks >>= 1;
+	bucket++;
+    }
+    readyLatency[bucket]++;
+    numDispatches++;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewThreadStats
+// 	Return a zeroed entry for the statistics of a new thread, or NULL
+//	if there is no room left for it.
+//
+//	"name" -- the name of the thread
+//----------------------------------------------------------------------
+
+ThreadStats *
+Statistics::NewThreadStats(const char *name)
+{
+    ThreadStats *t;
+
+    if (numThreadStats == MaxThreadStats)
+	return NULL;
+    t = &threadStats[numThreadStats++];
+    memset(t, 0, sizeof(ThreadStats));
+    strncpy(t->name, name, sizeof(t->name) - 1);
+    return t;
+}
+
+//----------------------------------------------------------------------
+// SyncStats::SyncStats
+// 	Initialize the statistics of a new synchronization object to zero,
+//	and add them at the end of the list of all of them.
+//
+//	"kindName" -- what the object is, e.g. "lock"
+//	"debugName" -- the name of the object (possibly truncated)
+//----------------------------------------------------------------------
+
+SyncStats *SyncStats::first = NULL;
+SyncStats *SyncStats::last = NULL;
+bool SyncStats::keepObjects = false;
+
+SyncStats::SyncStats(const char *kindName, const char *debugName)
+{
+    kind = kindName;
+    memset(name, 0, sizeof(name));
+    strncpy(name, debugName, sizeof(name) - 1);
+    numWaits = blockedTicks = maxBlockedTicks = 0;
+    numAcquires = holdTicks = numBoosts = 0;
+    summary = false;
+    next = NULL;
+    prev = last;
+    if (last == NULL)
+	first = this;
+    else
+	last->next = this;
+    last = this;
+}
+
+//----------------------------------------------------------------------
+// SyncStats::~SyncStats
+// 	Take the statistics out of the list.
+//----------------------------------------------------------------------
+
+SyncStats::~SyncStats()
+{
+    if (prev == NULL)
+	first = next;
+    else
+	prev->next = next;
+    if (next == NULL)
+	last = prev;
+    else
+	next->prev = prev;
+}
+
+//----------------------------------------------------------------------
+// SyncStats::Discard
+// 	Called when a synchronization object is de-allocated.  If anyone
+//	used it, its statistics are added to the summary of the objects
+//	with its kind and name that are already gone (it becomes that
+//	summary if there is none yet), or kept as they are if "keepObjects"
+//	is set.  Short-lived objects take no room of their own.
+//----------------------------------------------------------------------
+
+void
+SyncStats::Discard(SyncStats *s)
+{
+    SyncStats *sum;
+
+    if (s->numWaits == 0 && s->numAcquires == 0) {
+	delete s;
+	return;
+    }
+    if (keepObjects)
+	return;
+    for (sum = first; sum != NULL; sum = sum->next)
+	if (sum->summary && !strcmp(sum->kind, s->kind)
+		&& !strcmp(sum->name, s->name))
+	    break;
+    if (sum == NULL) {
+	s->summary = true;
+	return;
+    }
+    sum->numWaits += s->numWaits;
+    sum->blockedTicks += s->blockedTicks;
+    if (s->maxBlockedTicks > sum->maxBlockedTicks)
+	sum->maxBlockedTicks = s->maxBlockedTicks;
+    sum->numAcquires += s->numAcquires;
+    sum->holdTicks += s->holdTicks;
+    sum->numBoosts += s->numBoosts;
+    delete s;
+}
+
+//----------------------------------------------------------------------
+// PrintJSONString
+// 	Write "s" to "f" as a JSON string, with quotes, backslashes and
+//	control characters escaped.
+//----------------------------------------------------------------------
+
+static void
+PrintJSONString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s != '\0'; s++) {
+	if ((*s == '"') || (*s == '\\'))
+	    fprintf(f, "\\%c", *s);
+	else if ((unsigned char) *s < ' ')
+	    fprintf(f, "\\u%04x", *s);
+	else
+	    fputc(*s, f);
+    }
+    fputc('"', f);
 }
 
+// The kinds of synchronization objects, for Print.
+static const char *syncKinds[] = { "semaphore", "lock", "condition",
+				   "rwlock" };
+#define NumSyncKinds	((int) (sizeof(syncKinds) / sizeof(syncKinds[0])))
+
 //----------------------------------------------------------------------
 // Statistics::Print
 // 	Print performance metrics, when we've finished everything
-//	at system shutdown.
+//	at system shutdown.  Time blocked is given for each kind of
+//	synchronization object; PrintSyncProfile (-lp) lists the objects.
 //----------------------------------------------------------------------
 
 void
@@ -41,4 +221,300 @@ Statistics::Print()
     printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    printf("Scheduling: dispatches %d, average ready wait %d\n",
+	numDispatches, numDispatches ? readyWaitTicks / numDispatches : 0);
+    printf("Context switches: voluntary %d, involuntary %d\n",
+	numVoluntarySwitches, numInvoluntarySwitches);
+    printf("Ready latency:");
+    for (int i = 0; i < LatencyBuckets; i++)
+	if (readyLatency[i] > 0)
+	    printf(" <%d: %d,", 1 << i, readyLatency[i]);
+    printf("\n");
+    for (int k = 0; k < NumSyncKinds; k++) {
+	int waits = 0, ticks = 0;
+
+	for (SyncStats *s = SyncStats::first; s != NULL; s = s->next)
+	    if (!strcmp(s->kind, syncKinds[k])) {
+		waits += s->numWaits;
+		ticks += s->blockedTicks;
+	    }
+	if (waits > 0)
+	    printf("Blocked on %ss: waits %d, ticks %d\n", syncKinds[k],
+		waits, ticks);
+    }
+    for (int i = 0; i < numThreadStats; i++)
+	printf("Thread \"%s\": cpu %d, ready wait %d, switches voluntary %d, "
+	    "involuntary %d\n", threadStats[i].name, threadStats[i].cpuTicks,
+	    threadStats[i].waitTicks, threadStats[i].voluntarySwitches,
+	    threadStats[i].involuntarySwitches);
+
+    double user, system, cpu;
+
+    HostCpuTime(&user, &system);
+    cpu = user + system;
+    printf("Host: wall %.3fs, cpu %.3fs (user %.3fs, system %.3fs), "
+	"%.0f user instructions per cpu second\n", WallClock() - hostStartTime,
+	cpu, user, system, cpu > 0 ? userTicks / cpu : 0.0);
+    if (profile != NULL)
+	PrintHostProfile();
+    if (profileSync)
+	PrintSyncProfile();
+}
+
+//----------------------------------------------------------------------
+// ProfileTick
+// 	Called from a host signal when it is time to take a sample.
+//----------------------------------------------------------------------
+
+static void
+ProfileTick()
+{
+    profiled->HostSample();
+}
+
+//----------------------------------------------------------------------
+// Statistics::StartHostProfile
+// 	Start sampling what the simulator is doing, every ProfileInterval
+//	microseconds of host CPU time.
+//----------------------------------------------------------------------
+
+void
+Statistics::StartHostProfile()
+{
+    profile = new HostProfile;
+    memset(profile, 0, sizeof(HostProfile));
+    for (int i = 0; i < MaxProfilePCs; i++)
+	profile->pc[i] = -1;
+    profiled = this;
+    hostProfiling = true;
+    StartProfileTimer(ProfileTick, ProfileInterval);
+}
+
+//----------------------------------------------------------------------
+// Statistics::HostSample
+// 	Take a sample: count the activity, and either the user PC (if
+//	simulating user code) or the kernel label.  Called from a signal,
+//	so it cannot allocate memory.
+//----------------------------------------------------------------------
+
+void
+Statistics::HostSample()
+{
+    int activity = hostActivity;
+    const char *label = hostLabel;
+    int i;
+
+    profile->activity[activity]++;
+    if ((activity == HostUser) || (activity == HostTranslate)
+				|| (activity == HostDecode)) {
+	if (userPC == NULL)
+	    return;
+	int pc = *userPC;
+	int h = (pc >> 2) & (MaxProfilePCs - 1);
+
+	for (i = 0; i < MaxProfilePCs; i++, h = (h + 1) & (MaxProfilePCs - 1))
+	    if ((profile->pc[h] == pc) || (profile->pc[h] == -1)) {
+		profile->pc[h] = pc;
+		profile->pcSamples[h]++;
+		return;
+	    }
+    } else {
+	for (i = 0; i < profile->numLabels; i++)
+	    if (profile->label[i] == label) {
+		profile->labelSamples[i]++;
+		return;
+	    }
+	if (i < MaxProfileLabels) {
+	    profile->label[i] = label;
+	    profile->labelSamples[i] = 1;
+	    profile->numLabels++;
+	    return;
+	}
+    }
+    profile->numLost++;
+}
+
+//----------------------------------------------------------------------
+// PrintTop
+// 	Print the (at most) "n" entries with the most samples, out of 
+//	"total", and clear them.
+//----------------------------------------------------------------------
+
+static void
+PrintTop(int n, int *samples, int numEntries, int total, const int *pcs,
+	 const char **labels)
+{
+    for (; n > 0; n--) {
+	int best = -1;
+
+	for (int i = 0; i < numEntries; i++)
+	    if ((samples[i] > 0) && ((best == -1) || (samples[i] > samples[best])))
+		best = i;
+	if (best == -1)
+	    return;
+	if (pcs != NULL)
+	    printf("  0x%-8x", pcs[best]);
+	else
+	    printf("  %-24s", labels[best]);
+	printf(" %6d samples (%.1f%%)\n", samples[best],
+	    100.0 * samples[best] / total);
+	samples[best] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintHostProfile
+// 	Stop sampling, and print where the host's CPU time went: for each
+//	activity, and for the busiest user PCs and kernel labels.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintHostProfile()
+{
+    int total = 0, userTotal = 0, kernelTotal = 0;
+    int i;
+
+    StopProfileTimer();
+    for (i = 0; i < NumHostActivities; i++)
+	total += profile->activity[i];
+    printf("Host profile: %d samples of host CPU time\n", total);
+    if (total == 0)
+	return;
+    for (i = 0; i < NumHostActivities; i++)
+	if (profile->activity[i] > 0)
+	    printf("  %-24s %6d samples (%.1f%%)\n", hostActivityNames[i],
+		profile->activity[i], 100.0 * profile->activity[i] / total);
+    for (i = 0; i < MaxProfilePCs; i++)
+	userTotal += profile->pcSamples[i];
+    for (i = 0; i < profile->numLabels; i++)
+	kernelTotal += profile->labelSamples[i];
+    if (userTotal > 0) {
+	printf("Busiest user PCs:\n");
+	PrintTop(10, profile->pcSamples, MaxProfilePCs, total, profile->pc,
+	    NULL);
+    }
+    if (kernelTotal > 0) {
+	printf("Busiest kernel activities:\n");
+	PrintTop(10, profile->labelSamples, profile->numLabels, total, NULL,
+	    profile->label);
+    }
+    if (profile->numLost > 0)
+	printf("  (%d samples not classified)\n", profile->numLost);
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintSyncProfile
+// 	Print the NumHotSyncs synchronization objects where
+//	threads spent the most time blocked: how many times they were
+//	acquired, how many of those had to wait, for how long, how long
+//	locks were held, and how many times a holder was boosted.
+//----------------------------------------------------------------------
+
+static bool
+MoreContended(SyncStats *a, SyncStats *b)
+{
+    if (a->blockedTicks != b->blockedTicks)
+	return a->blockedTicks > b->blockedTicks;
+    if (a->numWaits != b->numWaits)
+	return a->numWaits > b->numWaits;
+    return a->numAcquires > b->numAcquires;
+}
+
+void
+Statistics::PrintSyncProfile()
+{
+    SyncStats *hot[NumHotSyncs];
+    int numHot = 0, i, j;
+
+    for (SyncStats *s = SyncStats::first; s != NULL; s = s->next) {
+	if (s->numAcquires == 0 && s->numWaits == 0)
+	    continue;
+	if (numHot == NumHotSyncs && !MoreContended(s, hot[numHot - 1]))
+	    continue;
+	if (numHot < NumHotSyncs)
+	    numHot++;
+	for (j = numHot - 1; j > 0 && MoreContended(s, hot[j - 1]); j--)
+	    hot[j] = hot[j - 1];
+	hot[j] = s;
+    }
+
+    printf("Synchronization profile, by time blocked:\n");
+    printf("  acquires  contended      %%  blocked ticks  max blocked  "
+	"held ticks  boosts  object\n");
+    for (i = 0; i < numHot; i++)
+	printf("  %8d  %9d  %5.1f  %13d  %11d  %10d  %6d  %s \"%s\"\n",
+	    hot[i]->numAcquires, hot[i]->numWaits, hot[i]->numAcquires ?
+		100.0 * hot[i]->numWaits / hot[i]->numAcquires : 0.0,
+	    hot[i]->blockedTicks, hot[i]->maxBlockedTicks, hot[i]->holdTicks,
+	    hot[i]->numBoosts, hot[i]->kind, hot[i]->name);
+}
+
+//----------------------------------------------------------------------
+// Statistics::DumpJSON
+// 	Write the collected statistics to a file as a JSON object, so they
+//	can be processed by other programs.
+//
+//	"fileName" -- the UNIX file to write them to
+//----------------------------------------------------------------------
+
+void
+Statistics::DumpJSON(const char *fileName)
+{
+    FILE *f = fopen(fileName, "w");
+    double user, system;
+    int i;
+
+    if (f == NULL) {
+	printf("Cannot write statistics to %s\n", fileName);
+	return;
+    }
+    fprintf(f, "{\n  \"ticks\": {\"total\": %d, \"idle\": %d, "
+	"\"system\": %d, \"user\": %d},\n", totalTicks, idleTicks,
+	systemTicks, userTicks);
+    fprintf(f, "  \"disk\": {\"reads\": %d, \"writes\": %d},\n",
+	numDiskReads, numDiskWrites);
+    fprintf(f, "  \"console\": {\"reads\": %d, \"writes\": %d},\n",
+	numConsoleCharsRead, numConsoleCharsWritten);
+    fprintf(f, "  \"pageFaults\": %d,\n", numPageFaults);
+    HostCpuTime(&user, &system);
+    fprintf(f, "  \"host\": {\"wallSeconds\": %.3f, \"userSeconds\": %.3f, "
+	"\"systemSeconds\": %.3f},\n", WallClock() - hostStartTime, user,
+	system);
+    fprintf(f, "  \"network\": {\"received\": %d, \"sent\": %d},\n",
+	numPacketsRecvd, numPacketsSent);
+    fprintf(f, "  \"scheduling\": {\"dispatches\": %d, "
+	"\"readyWaitTicks\": %d, \"voluntarySwitches\": %d, "
+	"\"involuntarySwitches\": %d,\n    \"readyLatency\": [",
+	numDispatches, readyWaitTicks, numVoluntarySwitches,
+	numInvoluntarySwitches);
+    for (i = 0; i < LatencyBuckets; i++)
+	fprintf(f, "%s%d", i ? ", " : "", readyLatency[i]);
+    fprintf(f, "]},\n  \"sync\": [");
+    i = 0;
+    for (SyncStats *s = SyncStats::first; s != NULL; s = s->next) {
+	if (s->numWaits == 0 && s->numAcquires == 0)
+	    continue;
+	fprintf(f, "%s\n    {\"kind\": \"%s\", \"name\": ", i++ ? "," : "",
+	    s->kind);
+	PrintJSONString(f, s->name);
+	fprintf(f, ", \"summary\": %s, \"waits\": %d, \"blockedTicks\": %d, "
+	    "\"maxBlockedTicks\": %d, \"acquires\": %d, \"holdTicks\": %d, "
+	    "\"boosts\": %d}", s->summary ? "true" : "false", s->numWaits,
+	    s->blockedTicks, s->maxBlockedTicks, s->numAcquires, s->holdTicks,
+	    s->numBoosts);
+    }
+    fprintf(f, "\n  ],\n  \"threads\": [");
+    for (i = 0; i < numThreadStats; i++) {
+	fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+	PrintJSONString(f, threadStats[i].name);
+	fprintf(f, ", \"cpuTicks\": %d, \"waitTicks\": %d, "
+	    "\"voluntarySwitches\": %d, \"involuntarySwitches\": %d, "
+	    "\"tickets\": %d, \"requestedTicks\": %.0f}",
+	    threadStats[i].cpuTicks, threadStats[i].waitTicks,
+	    threadStats[i].voluntarySwitches,
+	    threadStats[i].involuntarySwitches, threadStats[i].tickets,
+	    threadStats[i].requestedTicks);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
 }
@@ -13,6 +13,101 @@
 
 #include "copyright.h"
 
+// How many threads we keep statistics for, and the number of buckets
+// of the ready latency histogram.  Bucket 0
+// counts latencies of 0 ticks, and bucket i > 0 latencies from 2^(i-1)
+// to 2^i - 1 ticks; the last bucket also counts anything longer.
+
+#define MaxThreadStats 	64
+#define LatencyBuckets 	16
+
+// Number of synchronization objects listed by the profile (-lp) on halt.
+#define NumHotSyncs 	10
+
+// Scheduling statistics of one thread, kept after the thread is gone.
+
+class ThreadStats {
+  public:
+    char name[24];		// name of the thread (possibly truncated)
+    int cpuTicks;		// time it spent running
+    int waitTicks;		// time it spent on the ready list
+    int voluntarySwitches;	// times it gave up the CPU itself
+    int involuntarySwitches;	// times it was preempted
+    int tickets;		// tickets, for stride scheduling
+    double requestedTicks;	// CPU time its tickets entitled it to,
+				// while it was ready or running
+};
+
+// Time spent blocked on one synchronization object.  The other fields
+// are only kept when profiling them (-lp).
+//
+// Every semaphore, lock, condition variable and readers/writer lock
+// gets its own record when it is created (they may be created before
+// "stats" is, so the records are kept in a list of their own).  When
+// an object is de-allocated, Discard adds its counts to a single
+// record for all the de-allocated objects of the same kind and name,
+// so the list does not grow with every object ever created; only when
+// profiling them are the records of used objects kept one by one.
+
+class SyncStats {
+  public:
+    SyncStats(const char *kindName, const char *debugName);
+				// a zeroed record, added to the list
+    ~SyncStats();		// take it out of the list
+
+    static void Discard(SyncStats *s);	// the object is gone: add
+				// its counts to the summary, and free it
+    static bool keepObjects;	// keep the records of used objects
+				// instead (-lp)
+
+    static SyncStats *first;	// all the records, oldest first
+    SyncStats *next;
+
+    const char *kind;		// "semaphore", "lock", ...
+    char name[32];		// name of the object, for display
+    int numWaits;		// number of times a thread blocked
+    int blockedTicks;		// total time threads were blocked
+    int maxBlockedTicks;	// longest time a thread was blocked
+    int numAcquires;		// P's, lock acquisitions and waits
+    int holdTicks;		// total time locks were held
+    int numBoosts;		// times a lock holder inherited the
+				// priority of a thread waiting for it
+    bool summary;		// sums de-allocated objects, rather
+				// than being one that is alive
+
+  private:
+    static SyncStats *last;
+    SyncStats *prev;
+};
+
+// What the simulator itself is doing, for the host profiler (-hp).
+// The profiler periodically samples where the host's CPU time goes.
+
+enum HostActivity { HostKernel,		// running Nachos kernel code
+		    HostUser,		// simulating user instructions
+		    HostTranslate,	// translating user addresses
+		    HostDecode,		// decoding user instructions
+		    HostInterrupt,	// running an interrupt handler
+		    HostIdle,		// no threads to run
+		    NumHostActivities };
+
+#define MaxProfilePCs 	1024	// distinct user PCs sampled (a power of 2)
+#define MaxProfileLabels 64	// distinct kernel labels sampled
+
+// The host profile: how many samples fell on each user PC (while
+// simulating user code), or on each kernel label (otherwise).
+
+class HostProfile {
+  public:
+    int activity[NumHostActivities];	// samples per activity
+    int pc[MaxProfilePCs];		// user PCs, by hash (-1 if free)
+    int pcSamples[MaxProfilePCs];
+    const char *label[MaxProfileLabels];// kernel labels
+    int labelSamples[MaxProfileLabels];
+    int numLabels;
+    int numLost;			// samples with no room left
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -35,12 +130,58 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numDispatches;		// number of times a thread was given the CPU
+    int readyWaitTicks;		// total time threads spent on the ready
+				// list before being dispatched
+    int numVoluntarySwitches;	// context switches because the thread
+				// blocked or yielded
+    int numInvoluntarySwitches;	// context switches because the thread
+				// was preempted
+    int readyLatency[LatencyBuckets];	// histogram of the time spent on
+				// the ready list before each dispatch
+
+    ThreadStats threadStats[MaxThreadStats];	// per thread
+    int numThreadStats;
+
+    double hostStartTime;	// host wall clock time when Nachos started
+    volatile int hostActivity;	// what the simulator is doing now
+    const char * volatile hostLabel;	// ...and for whom, in the kernel
+				// (a string that is never de-allocated)
+    int *userPC;		// the PC of the user program, if any
+    HostProfile *profile;	// samples, if profiling the host
+    bool hostProfiling;		// profile != NULL (checked for every
+				// user instruction)
+    bool profileSync;		// count acquisitions, hold time and
+				// priority boosts too (-lp)?
 
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
+    void DumpJSON(const char *fileName);
+				// write collected statistics to a file,
+				// in JSON format
+
+    void RecordReadyLatency(int ticks);	// a thread was dispatched after
+				// waiting "ticks" on the ready list
+    ThreadStats *NewThreadStats(const char *name);
+				// statistics for a new thread, or NULL
+				// if there is no room left
+
+    void StartHostProfile();	// start sampling the host's CPU time
+    void HostSample();		// take a sample (from a host signal)
+    void PrintHostProfile();	// print the samples taken
+    void PrintSyncProfile();	// print the most contended
+				// synchronization objects
 };
 
+// Record what the simulator is doing, for the host profiler.  Only when
+// profiling: otherwise the stores to volatile memory, done for every
+// user instruction, would cost even without -hp.
+
+#define SetHostActivity(a, l) \
+	do { if (stats->hostProfiling) { stats->hostActivity = (a); \
+		stats->hostLabel = (l); } } while (0)
+
 // Constants used to reflect the relative time an operation would
 // take in a real system.  A "tick" is a just a unit of time -- if you 
 // like, a microsecond.
@@ -48,11 +189,16 @@ class Statistics {
 // Since Nachos kernel code is directly executed, and the time spent
 // in the kernel measured by the number of calls to enable interrupts,
 // these time constants are none too exact.
+//
+// The disk timings can be changed when Nachos starts (cf. system.cc),
+// so they are variables, defined in stats.cc.
 
 const int UserTick 	= 1;		// advance for each user-level instruction 
 const int SystemTick 	= 10; 		// advance each time interrupts are enabled
-const int RotationTime 	= 500;	 	// time disk takes to rotate one sector
-const int SeekTime 	= 500;    	// time disk takes to seek past one track
+extern int RotationTime;	 	// time disk takes to rotate one sector
+extern int SeekTime;    		// time disk takes to seek past one track
+extern int FlashTime;			// time a solid state disk takes to
+					// read or write one sector
 const int ConsoleTime 	= 100;		// time to read or write one character
 const int NetworkTime 	= 100;   	// time to send or receive one packet
 const int TimerTicks 	= 100;    	// (average) time between timer interrupts
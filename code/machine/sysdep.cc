@@ -34,6 +34,10 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -62,13 +66,10 @@ extern "C" {
 //	characters that can be read immediately.  If so, read them
 //	in, and return TRUE.
 //
-//	In the network case, if there are no threads for us to run,
-//	and no characters to be read,
-//	we need to give the other side a chance to get our host's CPU
-//	(otherwise, we'll go really slowly, since UNIX time-slices
-//	infrequently, and this would be like busy-waiting).  So we
-//	delay for a short fixed time, before allowing ourselves to be
-//	re-scheduled (sort of like a Yield, but cast in terms of UNIX).
+//	This used to delay for a short time when there were no threads
+//	to run, to give other Nachos processes a chance to get the host's
+//	CPU.  Instead, an idle Nachos now blocks in WaitForInput until
+//	there is something to read (cf. Interrupt::Idle).
 //
 //	"fd" -- the file descriptor of the file to be polled
 //----------------------------------------------------------------------
@@ -79,12 +80,9 @@ PollFile(int fd)
     int rfd = (1 << fd), wfd = 0, xfd = 0, retVal;
     struct timeval pollTime;
 
-// decide how long to wait if there are no characters on the file
+// don't wait if there are no characters on the file
     pollTime.tv_sec = 0;
-    if (interrupt->getStatus() == IdleMode)
-        pollTime.tv_usec = 20000;              	// delay to let other nachos run
-    else
-        pollTime.tv_usec = 0;                 	// no delay
+    pollTime.tv_usec = 0;
 
 // poll file or socket
 #ifdef HOST_LINUX
@@ -99,6 +97,50 @@ PollFile(int fd)
     return true;
 }
 
+//----------------------------------------------------------------------
+// WaitForInput
+// 	Check several open files or sockets at once to see if any of them
+//	has characters that can be read.  If "block" is set, wait until
+//	one of them does (the host's CPU is free in the meantime);
+//	otherwise, return right away.
+//
+//	Return TRUE if there is something to read.
+//
+//	This is called every time Nachos is idle, so the array given to
+//	poll is kept from one call to the next, and only grows.
+//
+//	"fds" -- the file descriptors of the files to be polled
+//	"numFds" -- how many there are
+//	"block" -- whether to wait for input
+//----------------------------------------------------------------------
+
+static struct pollfd *pollFds = NULL;
+static int maxPollFds = 0;
+
+bool
+WaitForInput(const int *fds, int numFds, bool block)
+{
+    int retVal;
+
+    if (numFds > maxPollFds) {
+	delete [] pollFds;
+	maxPollFds = numFds;
+	pollFds = new struct pollfd[maxPollFds];
+    }
+
+    for (int i = 0; i < numFds; i++) {
+	pollFds[i].fd = fds[i];
+	pollFds[i].events = POLLIN;
+	pollFds[i].revents = 0;
+    }
+    do {
+	retVal = poll(pollFds, numFds, block ? -1 : 0);
+    } while ((retVal < 0) && (errno == EINTR));	// interrupted by a signal
+
+    ASSERT(retVal >= 0);
+    return (retVal > 0);
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -364,6 +406,94 @@ CallOnUserAbort(VoidNoArgFunctionPtr func)
     (void)signal(SIGINT, (SignalHandler) func);
 }
 
+//----------------------------------------------------------------------
+// WallClock
+// 	Return the host's wall clock time, in seconds.
+//----------------------------------------------------------------------
+
+double
+WallClock()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+//----------------------------------------------------------------------
+// HostCpuTime
+// 	Return the host CPU time used so far by the UNIX process running
+//	Nachos, in seconds, split into user and system (UNIX kernel) time.
+//----------------------------------------------------------------------
+
+void
+HostCpuTime(double *user, double *system)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    *user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    *system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+//----------------------------------------------------------------------
+// StartProfileTimer
+// 	Arrange that "func" will be called every "usec" microseconds of
+//	host CPU time used by Nachos (user or system), from a UNIX signal.
+//
+//	The signal runs on a stack of its own, since the stacks of Nachos
+//	threads are small.
+//----------------------------------------------------------------------
+
+static VoidNoArgFunctionPtr profileHandler;
+
+static void
+ProfileSignal(int sig)
+{
+    (*profileHandler)();
+}
+
+void
+StartProfileTimer(VoidNoArgFunctionPtr func, int usec)
+{
+    static char *signalStack = NULL;
+    struct sigaction action;
+    struct itimerval interval;
+    stack_t stack;
+
+    if (signalStack == NULL) {
+	signalStack = new char[SIGSTKSZ];
+	stack.ss_sp = signalStack;
+	stack.ss_size = SIGSTKSZ;
+	stack.ss_flags = 0;
+	sigaltstack(&stack, NULL);
+    }
+    profileHandler = func;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ProfileSignal;
+    action.sa_flags = SA_RESTART | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    interval.it_interval.tv_sec = interval.it_value.tv_sec = 0;
+    interval.it_interval.tv_usec = interval.it_value.tv_usec = usec;
+    setitimer(ITIMER_PROF, &interval, NULL);
+}
+
+//----------------------------------------------------------------------
+// StopProfileTimer
+// 	Stop calling the routine given to StartProfileTimer.
+//----------------------------------------------------------------------
+
+void
+StopProfileTimer()
+{
+    struct itimerval interval;
+
+    memset(&interval, 0, sizeof(interval));
+    setitimer(ITIMER_PROF, &interval, NULL);
+}
+
 //----------------------------------------------------------------------
 // Sleep
 // 	Put the UNIX process running Nachos to sleep for x seconds,
@@ -379,12 +509,15 @@ Delay(int seconds)
 
 //----------------------------------------------------------------------
 // Abort
-// 	Quit and drop core.
+// 	Quit and drop core.  The events traced so far are written out
+//	first.
 //----------------------------------------------------------------------
 
 void 
 Abort()
 {
+    if (trace != NULL)
+	trace->Flush();
     abort();
 }
 
@@ -438,9 +571,21 @@ char *
 AllocBoundedArray(int size)
 {
     int pgSize = getpagesize();
+#ifdef HOST_LINUX
+    // new[] memory is not page aligned, so the boundary pages could not
+    // be protected; map the pages directly instead.  The array starts
+    // right after the lower guard page, where a stack overflow would hit.
+    int mapped = divRoundUp(size, pgSize) * pgSize;
+    char *ptr = (char *) mmap(NULL, pgSize * 2 + mapped, 
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 
+			-1, 0);
+
+    ASSERT(ptr != (char *) MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + pgSize + mapped, pgSize, PROT_NONE);
+#else
     char *ptr = new char[pgSize * 2 + size];
 
-#ifndef HOST_LINUX
     mprotect(ptr, pgSize, 0);
     mprotect(ptr + pgSize + size, pgSize, 0);
 #endif
@@ -449,7 +594,8 @@ AllocBoundedArray(int size)
 
 //----------------------------------------------------------------------
 // DeallocBoundedArray
-// 	Deallocate an array of integers, unprotecting its two boundary pages.
+// 	Deallocate an array of integers, unprotecting its two boundary pages
+//	(or unmapping the whole thing, on Linux).
 //
 //	"ptr" -- the array to be deallocated
 //	"size" -- amount of useful space in the array (in bytes)
@@ -460,9 +606,13 @@ DeallocBoundedArray(const char *ptr, int size)
 {
     int pgSize = getpagesize();
 
-#ifndef HOST_LINUX
+#ifdef HOST_LINUX
+    int mapped = divRoundUp(size, pgSize) * pgSize;
+
+    munmap((void *) (ptr - pgSize), pgSize * 2 + mapped);
+#else
     mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
     mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-#endif
     delete [] (ptr - pgSize);
+#endif
 }
@@ -17,6 +17,10 @@
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+// Check several files at once; if "block" is set, wait until
+// there are characters to be read in at least one of them.
+extern bool WaitForInput(const int *fds, int numFds, bool block);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(const char *name);
@@ -46,6 +50,15 @@ extern void Delay(int seconds);
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
+// Host time, in seconds: wall clock, and CPU time used by Nachos
+extern double WallClock();
+extern void HostCpuTime(double *user, double *system);
+
+// Call "func" every "usec" microseconds of host CPU time, to profile
+// Nachos itself
+extern void StartProfileTimer(VoidNoArgFunctionPtr func, int usec);
+extern void StopProfileTimer();
+
 // Initialize the pseudo random number generator
 extern void RandomInit(unsigned seed);
 extern int Random();
@@ -46,23 +46,105 @@ Timer::Timer(VoidFunctionPtr timerHandler, void* callArg, bool doRandom)
     randomize = doRandom;
     handler = timerHandler;
     arg = callArg; 
+    oneShot = armed = false;
 
-    // schedule the first interrupt from the timer device
-    interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(), 
+    // schedule the first interrupt from the timer device; unless the
+    // delay is random, it just repeats from then on
+    if (randomize)
+	event = interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(), 
 		TimerInt); 
+    else
+	event = interrupt->SchedulePeriodic(TimerHandler, this, TimerTicks,
+		TimerInt);
+}
+
+//----------------------------------------------------------------------
+// Timer::Timer
+//      Initialize a one-shot timer device.  No interrupt happens until
+//	the timer is armed.
+//
+//      "timerHandler" is the interrupt handler for the timer device.
+//      "callArg" is the parameter to be passed to the interrupt handler.
+//----------------------------------------------------------------------
+
+Timer::Timer(VoidFunctionPtr timerHandler, void* callArg)
+{
+    randomize = false;
+    handler = timerHandler;
+    arg = callArg; 
+    oneShot = true;
+    armed = false;
+    expiresAt = 0;
+    event = 0;
+}
+
+//----------------------------------------------------------------------
+// Timer::~Timer
+//      Stop the timer device, cancelling its pending interrupt.
+//----------------------------------------------------------------------
+
+Timer::~Timer()
+{
+    if (event != 0)
+	interrupt->Cancel(event);
+}
+
+//----------------------------------------------------------------------
+// Timer::Arm
+//      Arrange for a one-shot timer to interrupt "ticks" from now,
+//	replacing any interrupt that was pending.
+//----------------------------------------------------------------------
+
+void
+Timer::Arm(int ticks)
+{
+    int when = stats->totalTicks + ticks;
+
+    ASSERT(oneShot && ticks > 0);
+    if (armed && when == expiresAt)
+	return;				// already pending for that time
+    if (armed)
+	interrupt->Cancel(event);
+    armed = true;
+    expiresAt = when;
+    event = interrupt->Schedule(TimerHandler, this, ticks, TimerInt);
+}
+
+//----------------------------------------------------------------------
+// Timer::Disarm
+//      Cancel the pending interrupt of a one-shot timer, if any.
+//----------------------------------------------------------------------
+
+void
+Timer::Disarm()
+{
+    if (armed)
+	interrupt->Cancel(event);
+    armed = false;
+    event = 0;
 }
 
 //----------------------------------------------------------------------
 // Timer::TimerExpired
 //      Routine to simulate the interrupt generated by the hardware 
-//	timer device.  Schedule the next interrupt, and invoke the
-//	interrupt handler.
+//	timer device.  Schedule the next interrupt (if the delay is
+//	random; otherwise it is periodic), and invoke the interrupt
+//	handler.  A one-shot timer just invokes the handler.
 //----------------------------------------------------------------------
 void 
 Timer::TimerExpired() 
 {
+    if (oneShot) {
+	ASSERT(armed);
+	armed = false;
+	event = 0;
+	(*handler)(arg);
+	return;
+    }
+
     // schedule the next timer device interrupt
-    interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(), 
+    if (randomize)
+	event = interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(), 
 		TimerInt);
 
     // invoke the Nachos interrupt handler for this device
@@ -11,6 +11,10 @@
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	A one-shot timer instead interrupts only once each time it is armed,
+//	after the number of ticks it is armed with.  Re-arming or disarming
+//	it cancels the interrupt that was pending.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -29,7 +33,13 @@ class Timer {
     Timer(VoidFunctionPtr timerHandler, void* callArg, bool doRandom);
 				// Initialize the timer, to call the interrupt
 				// handler "timerHandler" every time slice.
-    ~Timer() {}
+    Timer(VoidFunctionPtr timerHandler, void* callArg);
+				// Initialize a one-shot timer, disarmed
+    ~Timer();			// Stop the timer
+
+    void Arm(int ticks);	// One-shot: interrupt "ticks" from now
+    void Disarm();		// One-shot: cancel the pending interrupt
+    bool IsArmed() { return armed; }
 
 // Internal routines to the timer emulation -- DO NOT call these
 
@@ -43,6 +53,10 @@ class Timer {
     bool randomize;		// set if we need to use a random timeout delay
     VoidFunctionPtr handler;	// timer interrupt handler 
     void* arg;			// argument to pass to interrupt handler
+    bool oneShot;		// interrupt only when armed
+    bool armed;			// one-shot: is an interrupt pending?
+    int expiresAt;		// one-shot: when it is due
+    int event;			// the pending interrupt (cf. Interrupt::Cancel)
 
 };
 
@@ -0,0 +1,220 @@
+// trace.cc
+//	Routines to record a trace of the events of a Nachos run, and to
+//	replay it.  See trace.h for what is traced, and why.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+// String definitions for debugging messages
+
+static const char *traceTypeNames[] = { "interrupt", "switch", "syscall",
+					"disk", "input" };
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Open a trace file.  When recording, write the header; when
+//	replaying, read it, so that Nachos can use the same random seed.
+//
+//	"fileName" -- UNIX file holding the trace
+//	"replay" -- replay the trace, instead of recording a new one
+//	"randomYield", "seed" -- if recording, whether -rs was given, and
+//		its seed
+//----------------------------------------------------------------------
+
+Trace::Trace(const char *fileName, bool replay, bool randomYield, int seed)
+{
+    replaying = replay;
+    buffer = new TraceEvent[TraceBufferSize];
+    numBuffered = next = numEvents = 0;
+    diverged = false;
+
+    if (replaying) {
+	fileno = OpenForReadWrite(fileName, true);
+	Read(fileno, (char *) &header, sizeof(header));
+	ASSERT(header.magic == TraceMagic);
+    } else {
+	fileno = OpenForWrite(fileName);
+	header.magic = TraceMagic;
+	header.randomYield = randomYield;
+	header.seed = seed;
+	WriteFile(fileno, (char *) &header, sizeof(header));
+    }
+}
+
+//----------------------------------------------------------------------
+// Trace::~Trace
+// 	Finish the trace.  Events still in the buffer are written out; a
+//	replay says whether it matched the recorded run.
+//----------------------------------------------------------------------
+
+Trace::~Trace()
+{
+    if (replaying) {
+	if (!diverged && Peek() != NULL)
+	    Print("Replay ended early; next recorded event", Peek());
+	else if (!diverged)
+	    printf("Replay: all %d events matched the trace\n", numEvents);
+    } else {
+	Flush();
+	printf("Trace: %d events recorded\n", numEvents);
+    }
+    Close(fileno);
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// Trace::Record
+// 	Called when something worth tracing happens.  When recording, add
+//	it to the buffer, writing the buffer out if it is full.  When
+//	replaying, check it against the trace.
+//
+//	"type" -- what kind of event it is
+//	"what", "value" -- details, depending on the type (cf. trace.h)
+//----------------------------------------------------------------------
+
+void
+Trace::Record(TraceType type, int what, int value)
+{
+    if (replaying) {
+	Check(type, what, value);
+	return;
+    }
+    if (numBuffered == TraceBufferSize)
+	Flush();
+
+    TraceEvent *event = &buffer[numBuffered++];
+
+    event->ticks = stats->totalTicks;
+    event->type = type;
+    event->what = what;
+    event->value = value;
+    numEvents++;
+}
+
+//----------------------------------------------------------------------
+// Trace::Flush
+// 	Write the buffered events to the trace, with a single write.
+//	Also called if Nachos crashes, so that the trace shows what led
+//	up to it.
+//----------------------------------------------------------------------
+
+void
+Trace::Flush()
+{
+    if (replaying)
+	return;
+    if (numBuffered > 0)
+	WriteFile(fileno, (char *) buffer, numBuffered * sizeof(TraceEvent));
+    numBuffered = 0;
+}
+
+//----------------------------------------------------------------------
+// Trace::Peek
+// 	Return the next event of the trace being replayed, without
+//	consuming it, or NULL if there are no more.  The buffer is
+//	refilled a block at a time.
+//----------------------------------------------------------------------
+
+TraceEvent *
+Trace::Peek()
+{
+    if (next == numBuffered) {
+	next = 0;
+	numBuffered = ReadPartial(fileno, (char *) buffer,
+			TraceBufferSize * sizeof(TraceEvent)) / sizeof(TraceEvent);
+	if (numBuffered <= 0) {
+	    numBuffered = 0;
+	    return NULL;
+	}
+    }
+    return &buffer[next];
+}
+
+//----------------------------------------------------------------------
+// Trace::Check
+// 	An event happened while replaying; it should be the next one in
+//	the trace.  If it is not, report where the runs diverged, and stop
+//	checking (everything after that is bound to differ too).
+//----------------------------------------------------------------------
+
+void
+Trace::Check(TraceType type, int what, int value)
+{
+    TraceEvent *expected, event;
+
+    if (diverged)
+	return;
+    event.ticks = stats->totalTicks;
+    event.type = type;
+    event.what = what;
+    event.value = value;
+    expected = Peek();
+
+    if ((expected == NULL) || (expected->ticks != event.ticks)
+	    || (expected->type != event.type) || (expected->what != event.what)
+	    || (expected->value != event.value)) {
+	printf("Replay diverged after %d events\n", numEvents);
+	if (expected != NULL)
+	    Print("  recorded", expected);
+	else
+	    printf("  recorded: end of trace\n");
+	Print("  replayed", &event);
+	diverged = true;
+	return;
+    }
+    if (DebugIsEnabled('r'))
+	Print("Replayed", expected);
+    next++;
+    numEvents++;
+}
+
+//----------------------------------------------------------------------
+// Trace::ReplayInput
+// 	Called by the console when it polls for input while replaying.
+//	Return the next character recorded, if it was read by this time.
+//	Once the replay has diverged, events before the next character
+//	are skipped, so that the input keeps coming.
+//
+//	"ch" -- where to put the character
+//----------------------------------------------------------------------
+
+bool
+Trace::ReplayInput(char *ch)
+{
+    TraceEvent *event;
+
+    while (diverged && ((event = Peek()) != NULL)
+				&& (event->type != TraceInput))
+	next++;
+    event = Peek();
+    if ((event == NULL) || (event->type != TraceInput)
+			|| (event->ticks > stats->totalTicks))
+	return false;
+    if (DebugIsEnabled('r'))
+	Print("Replayed", event);
+    *ch = event->value;
+    next++;
+    numEvents++;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Trace::Print
+// 	Print an event, for debugging.
+//----------------------------------------------------------------------
+
+void
+Trace::Print(const char *what, TraceEvent *event)
+{
+    printf("%s: %s at time %d (%d, %d)\n", what,
+	((event->type >= 0) && (event->type < NumTraceTypes)) ?
+		traceTypeNames[event->type] : "unknown",
+	event->ticks, event->what, event->value);
+}
@@ -0,0 +1,111 @@
+// trace.h
+//	Data structures to record a trace of the events of a Nachos run,
+//	and to replay it later.
+//
+//	The trace is a binary file: a header, followed by one fixed-size
+//	record per event (interrupts, context switches, system calls,
+//	disk requests, console input), each stamped with the simulated
+//	time.  Records are collected in a large buffer, and written out
+//	in blocks, so that tracing costs little more than a copy.
+//
+//	Nachos itself is deterministic: given the same command line and
+//	the same random seed (-rs), it behaves the same way, except for
+//	what comes from the host -- mainly, when console input arrives.
+//	When replaying, the seed is taken from the trace, the console
+//	reads its input from the trace (at the same simulated times, not
+//	from the host), and every event is checked against the one that
+//	was recorded, to report the first place where the runs diverge.
+//
+//	Device polls that find nothing are not traced, since how many
+//	there are depends on the host (cf. Interrupt::SkipPolls).  The
+//	network is not replayed.
+//
+//	The trace is in host byte order.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define TraceMagic	0x54524331	// "TRC1"
+#define TraceBufferSize	4096		// events buffered at once
+
+// The kinds of events in a trace.
+enum TraceType { TraceInterrupt,	// "what" is the IntType
+		 TraceSwitch,		// "what" is 1 if preempted,
+					// "value" the pid of the next thread
+		 TraceSyscall,		// "what" is the system call,
+					// "value" its first argument
+		 TraceDisk,		// "what" is 1 for a write,
+					// "value" the sector
+		 TraceInput,		// "value" is the character read
+		 NumTraceTypes };
+
+// One event, as stored in the file.
+
+class TraceEvent {
+  public:
+    int ticks;			// when it happened
+    short type;			// a TraceType
+    short what;			// depends on the type
+    int value;			// depends on the type
+};
+
+// The header at the start of the file.
+
+class TraceHeader {
+  public:
+    int magic;			// TraceMagic
+    int randomYield;		// was -rs given?
+    int seed;			// if so, its seed
+};
+
+// The following class defines a trace being recorded or replayed.
+
+class Trace {
+  public:
+    Trace(const char *fileName, bool replay, bool randomYield, int seed);
+				// Start recording a trace into "fileName",
+				// or replaying the trace in it
+    ~Trace();			// Write out what is still buffered, or
+				// print how the replay went
+
+    void Record(TraceType type, int what, int value);
+				// An event happened.  When replaying,
+				// check that it was the next one recorded
+    bool Replaying() { return replaying; }
+    bool ReplayInput(char *ch);	// When replaying, return the next
+				// character of console input, if it
+				// arrived by now
+
+    void Flush();		// Write out the buffer, if recording
+
+    bool RandomYield() { return header.randomYield; }
+    int Seed() { return header.seed; }
+
+  private:
+    int fileno;			// UNIX file descriptor of the trace
+    bool replaying;		// replaying it, or recording it?
+    TraceHeader header;
+    TraceEvent *buffer;		// events not yet written, or not yet
+				// replayed
+    int numBuffered;		// how many there are in the buffer
+    int next;			// next event in the buffer to replay
+    int numEvents;		// events recorded, or replayed so far
+    bool diverged;		// has the replay stopped matching?
+
+    TraceEvent *Peek();		// Next recorded event, NULL at the end
+    void Check(TraceType type, int what, int value);
+				// Compare an event with the next one
+				// recorded
+    void Print(const char *what, TraceEvent *event);
+};
+
+#endif // TRACE_H
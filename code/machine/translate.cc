@@ -93,7 +93,12 @@ Machine::ReadMem(int addr, int size, int *value)
     
     DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
+    int activity = stats->hostActivity;		// for the host profiler
+    const char *label = stats->hostLabel;
+
+    SetHostActivity(HostTranslate, label);
     exception = Translate(addr, &physicalAddress, size, false);
+    SetHostActivity(activity, label);
     if (exception != NoException) {
 	machine->RaiseException(exception, addr);
 	return false;
@@ -142,7 +147,12 @@ Machine::WriteMem(int addr, int size, int value)
      
     DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
+    int activity = stats->hostActivity;		// for the host profiler
+    const char *label = stats->hostLabel;
+
+    SetHostActivity(HostTranslate, label);
     exception = Translate(addr, &physicalAddress, size, true);
+    SetHostActivity(activity, label);
     if (exception != NoException) {
 	machine->RaiseException(exception, addr);
 	return false;
@@ -130,6 +130,54 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl SetTickets
+	.ent	SetTickets
+SetTickets:
+	addiu $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end SetTickets
+
+	.globl ChannelCreate
+	.ent	ChannelCreate
+ChannelCreate:
+	addiu $2,$0,SC_ChannelCreate
+	syscall
+	j	$31
+	.end ChannelCreate
+
+	.globl ChannelSend
+	.ent	ChannelSend
+ChannelSend:
+	addiu $2,$0,SC_ChannelSend
+	syscall
+	j	$31
+	.end ChannelSend
+
+	.globl ChannelReceive
+	.ent	ChannelReceive
+ChannelReceive:
+	addiu $2,$0,SC_ChannelReceive
+	syscall
+	j	$31
+	.end ChannelReceive
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,86 @@
+// alarm.cc 
+//	Routines to put threads to sleep for an amount of simulated time.
+//	See alarm.h for the overall design.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// AlarmWakeUp
+// 	Interrupt handler for a sleeping thread.  Need this to be a C
+//	routine, because C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+AlarmWakeUp(void* arg)
+{
+    alarmClock->WakeUp((Thread *) arg);
+}
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+// 	Initialize the alarm clock, with no thread asleep.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    numSleeping = 0;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+// 	De-allocate the alarm clock.  The interrupts of threads still
+//	asleep go away with the interrupt simulation.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep until "ticks" of simulated time
+//	have passed.  Other threads run in the meantime; if there are
+//	none, the machine idles until the thread has to wake up.
+//
+//	"ticks" -- how long to sleep; nothing happens if it is not
+//		positive
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int ticks)
+{
+    if (ticks <= 0)
+	return;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    DEBUG('t', "Thread \"%s\" sleeping until time %d\n",
+	currentThread->getName(), stats->totalTicks + ticks);
+    interrupt->Schedule(AlarmWakeUp, currentThread, ticks, AlarmInt);
+    numSleeping++;
+    currentThread->Sleep();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WakeUp
+// 	The time of a sleeping thread is up; put it back on the ready
+//	list.  Called from its interrupt, so interrupts are disabled.
+//
+//	"thread" -- the thread to wake up
+//----------------------------------------------------------------------
+
+void
+Alarm::WakeUp(Thread *thread)
+{
+    DEBUG('t', "Waking up thread \"%s\" at time %d\n", thread->getName(),
+	stats->totalTicks);
+    numSleeping--;
+    scheduler->ReadyToRun(thread);
+}
@@ -0,0 +1,48 @@
+// alarm.h 
+//	Data structures for a software alarm clock.
+//
+//	The alarm clock lets a thread go to sleep until a given amount of
+//	simulated time has passed, instead of calling Yield over and over
+//	again until it is time (which keeps the CPU busy, and the thread
+//	on the ready list).
+//
+//	Each sleeping thread has its own interrupt scheduled for when it
+//	must wake up (cf. Interrupt::Schedule); since pending interrupts
+//	are kept in a heap, this costs O(log n) per sleeping thread.  The
+//	interrupts are of type AlarmInt, so Nachos keeps running while
+//	there are threads asleep, even if nothing else is ready.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "utility.h"
+
+class Thread;
+
+// The following class defines the alarm clock.
+
+class Alarm {
+  public:
+    Alarm();			// Initialize the alarm clock
+    ~Alarm();			// De-allocate it
+
+    void WaitUntil(int ticks);	// Suspend the current thread until at
+				// least "ticks" of simulated time
+				// have passed
+
+    int NumSleeping() { return numSleeping; }
+				// How many threads are asleep
+
+    void WakeUp(Thread *thread);// Called by the interrupt of a sleeping
+				// thread, when it is time to wake it up
+
+  private:
+    int numSleeping;		// Threads waiting for their interrupt
+};
+
+#endif // ALARM_H
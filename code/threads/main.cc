@@ -8,20 +8,43 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -mlfq -stride
+//		-q <quantum> -js <stats file> -hp -lp -tr <trace> -tp <trace>
+//		-s -up -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-p <nachos file> -r <nachos file> -l -D -t -tb <workload>
+//		-dg <tracks> <sectors per track> -dt <seek> <rotation>
+//		-di -ds <channels> <latency>
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -mlfq schedules threads with multilevel feedback queues, instead
+//	  of fixed priorities (cf. scheduler.cc)
+//    -stride schedules threads in proportion to their tickets, instead
+//	  of by priority
+//    -q sets the time slice (in ticks) of the scheduling policy in use;
+//	  threads are only interrupted when another thread is ready
+//    -js writes the statistics to a file, in JSON format, on halt
+//    -hp samples where the simulator itself spends the host's CPU time
+//	  (simulating user instructions, translating addresses, running
+//	  system calls...), and prints it on halt
+//    -lp counts acquisitions, waits, hold time and priority boosts of
+//	  every lock, semaphore and condition variable, and prints the
+//	  most contended ones on halt
+//    -tr records a trace of the events of the run (interrupts, context
+//	  switches, system calls, disk requests and console input)
+//    -tp replays a trace recorded with -tr: run Nachos with the same
+//	  arguments, but -tp instead of -tr (and -rs can be left out);
+//	  reports where the run diverges from the recorded one
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -up counts the instructions executed by each user program, and
+//	  prints them by procedure and by basic block on halt
 //    -x runs a user program
 //    -c tests the console
 //
@@ -33,6 +56,13 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -tb runs a file system benchmark workload ("all" runs every one;
+//	  see fstest.cc)
+//    -dg sets the number of tracks and sectors per track of the disk
+//    -dt sets the time (in ticks) to seek one track and rotate one sector
+//    -di makes every disk request take a single tick
+//    -ds simulates a solid state disk with the given number of channels,
+//	  taking a fixed number of ticks per request
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -60,6 +90,7 @@ void ThreadTest();
 void Copy(const char *unixFile, const char *nachosFile);
 void Print(const char *file);
 void PerformanceTest(void);
+void Benchmark(const char *which);
 void StartProcess(const char *file);
 void ConsoleTest(const char *in, const char *out);
 void MailTest(int networkID);
@@ -71,6 +102,12 @@ void VCTest();
 void SendReceiveTest();
 void ForkerThread();
 void PriorityTest();
+void ChainPriorityTest();
+void StrideTest();
+void AlarmTest();
+void RWLockTest();
+void RWPriorityTest();
+void ChannelTest();
 //----------------------------------------------------------------------
 // main
 // 	Bootstrap the operating system kernel.  
@@ -103,6 +140,12 @@ main(int argc, char **argv)
     //SendReceiveTest();
     //ForkerThread();
     PriorityTest();
+    //ChainPriorityTest();
+    //StrideTest();
+    //AlarmTest();
+    //RWLockTest();
+    //RWPriorityTest();
+    //ChannelTest();
 #endif
 
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -146,6 +189,10 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-tb")) {	// benchmark
+	    ASSERT(argc > 1);
+            Benchmark(*(argv + 1));
+	    argCount = 2;
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -160,6 +207,11 @@ main(int argc, char **argv)
 #endif // NETWORK
     }
 
+#ifdef FILESYS
+    fileSystem->Sync();		// commit the metadata changes made by
+				// the commands above
+#endif // FILESYS
+
     currentThread->Finish();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
 				// will exit (as any other normal program
@@ -11,8 +11,25 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Strict priorities, FIFO within each priority.  The ready threads
+//	of each priority are kept in a queue linked through the threads
+//	themselves, and a bitmap records which queues are not empty, so
+//	both enqueueing and finding the next thread take constant time
+//	and never allocate memory.
+//
+//	With the FeedbackQueues policy the priority of a thread is its
+//	level in a multilevel feedback queue: new threads start at the top
+//	level, a thread that uses its whole quantum is moved down a level,
+//	a thread woken up by an I/O interrupt is moved up a level, and
+//	threads that have been waiting on the ready list for a long time
+//	are moved up too, so they don't starve.
+//
+//	With the StrideScheduling policy priorities are ignored.  Each
+//	thread has a number of tickets, and a "pass" that advances, as it
+//	uses the CPU, by STRIDE1 / tickets per tick.  The ready thread with
+//	the smallest pass runs next, so over time each thread gets a share
+//	of the CPU proportional to its tickets.  The ready threads are kept
+//	in a heap ordered by pass.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -30,7 +47,22 @@
 Scheduler::Scheduler()
 { 
     for (int i = 0; i < MAX_PRIORITY; i++)
-		readyList[i] = new List<Thread*>;
+    {
+		readyHead[i] = NULL;
+		readyTail[i] = NULL;
+	}
+	readyMask = 0;
+	policy = StaticPriorities;
+	quantum = STATIC_QUANTUM;
+	lastAging = 0;
+	heapCapacity = 16;
+	heap = new Thread *[heapCapacity];
+	heapSize = 0;
+	globalPass = 0;
+	competingTickets = 0;
+	ticksPerTicket = 0;
+	sharesUpdated = 0;
+	preempting = false;
 } 
 
 //----------------------------------------------------------------------
@@ -40,8 +72,7 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    for (int i = 0; i < MAX_PRIORITY; i++)
-		delete readyList[i];
+	delete [] heap;
 } 
 
 //----------------------------------------------------------------------
@@ -57,14 +88,107 @@ Scheduler::ReadyToRun (Thread *thread)
 {
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
-	thread->setStatus(READY);
+	if (policy == FeedbackQueues)
+	{
+		// Los hilos nuevos empiezan en el nivel más alto; los que se
+		// despiertan por una interrupción (terminó su E/S) suben uno.
+		if (thread->getStatus() == JUST_CREATED)
+			SetLevel(thread, MAX_PRIORITY - 1);
+		else if (thread->getStatus() == BLOCKED && interrupt->InHandler()
+			&& thread->getInitialPriority() < MAX_PRIORITY - 1)
+			SetLevel(thread, thread->getInitialPriority() + 1);
+	}
+	
+	// Si ya estaba en la cola (ver Thread::Yield), sigue esperando
+	// desde antes.
+	if (thread->getStatus() != READY)
+		thread->readySince = stats->totalTicks;
+	
+	// Si recién llega o estuvo bloqueado, empieza a competir.
+	if (thread->getStatus() == JUST_CREATED || thread->getStatus() == BLOCKED)
+		StartCompeting(thread);
+	
+	if (policy == StrideScheduling)
+	{
+		// Un hilo que recién llega, o que estuvo bloqueado, no puede
+		// reclamar la CPU que no usó mientras no competía.
+		if (thread->getStatus() != READY && thread->pass < globalPass)
+			thread->pass = globalPass;
+		thread->setStatus(READY);
+		HeapInsert(thread);
+	}
+	else
+	{
+		thread->setStatus(READY);
+		// Insertamos el hilo en la cola correspondiente a su prioridad.
+		Enqueue(thread);
+	}
 	
+	// Ahora hay con quién repartir la CPU.
+	ArmSlice();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Enqueue
+// 	Ponemos al hilo al final de la cola de su prioridad, y marcamos
+//	la cola como no vacía.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Enqueue(Thread *thread)
+{
 	// Obtenemos la prioridad del hilo
 	int priority = thread->getPriority();
     // Verificamos que la prioridad sea válida.
     ASSERT(0 <= priority && priority < MAX_PRIORITY);
-    // Insertamos el hilo en la cola correspondiente a su prioridad.
-    readyList[priority]->Append(thread);
+    
+    thread->readyNext = NULL;
+    thread->readyPrev = readyTail[priority];
+    if (readyTail[priority] == NULL)
+		readyHead[priority] = thread;
+	else
+		readyTail[priority]->readyNext = thread;
+	readyTail[priority] = thread;
+	readyMask |= 1 << priority;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dequeue
+// 	Sacamos al primer hilo de la cola de prioridad "priority", que no
+//	puede estar vacía.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Dequeue(int priority)
+{
+	Thread *thread = readyHead[priority];
+	
+	ASSERT(thread != NULL);
+	Unlink(thread, priority);
+	return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Unlink
+// 	Sacamos al hilo de la cola de prioridad "priority", en la que
+//	tiene que estar, sin importar en qué lugar de la cola esté.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Unlink(Thread *thread, int priority)
+{
+	if (thread->readyPrev == NULL)
+		readyHead[priority] = thread->readyNext;
+	else
+		thread->readyPrev->readyNext = thread->readyNext;
+	if (thread->readyNext == NULL)
+		readyTail[priority] = thread->readyPrev;
+	else
+		thread->readyNext->readyPrev = thread->readyPrev;
+	
+	if (readyHead[priority] == NULL)
+		readyMask &= ~(1 << priority);
+	thread->readyNext = thread->readyPrev = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -78,15 +202,13 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-	for (int i = (MAX_PRIORITY - 1); i >= 0; i--)
-	{
-		if (!readyList[i]->IsEmpty())
-		{
-			// Devolvemos el hilo con mayor prioridad.
-			return readyList[i]->Remove();
-		}
-	}
-	return NULL;
+	if (policy == StrideScheduling)
+		return (heapSize == 0) ? NULL : HeapRemoveMin();
+	if (readyMask == 0)
+		return NULL;
+	// Devolvemos el primer hilo de la cola no vacía de mayor prioridad,
+	// que es el bit más alto encendido en readyMask.
+	return Dequeue(31 - __builtin_clz(readyMask));
 }
 
 //----------------------------------------------------------------------
@@ -118,8 +240,42 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    // Llevamos la cuenta del tiempo de CPU de cada hilo, y de cuánto
+    // esperó en la cola de listos.  Si el hilo se bloqueó, la cuenta
+    // ya la hizo Thread::Sleep, antes de esperar una interrupción.
+    if (oldThread->getStatus() != BLOCKED)
+	Charge(oldThread);
+    if (policy == StrideScheduling)
+	globalPass = nextThread->pass;
+    nextThread->waitTicks += stats->totalTicks - nextThread->readySince;
+    stats->readyWaitTicks += stats->totalTicks - nextThread->readySince;
+    stats->RecordReadyLatency(stats->totalTicks - nextThread->readySince);
+    nextThread->runningSince = stats->totalTicks;
+
+    // Contamos el cambio de contexto: es involuntario si al hilo lo
+    // desalojaron (ver Preempt); si no, se bloqueó o cedió la CPU.
+    if (oldThread != nextThread) {
+	if (preempting) {
+	    oldThread->involuntarySwitches++;
+	    stats->numInvoluntarySwitches++;
+	} else {
+	    oldThread->voluntarySwitches++;
+	    stats->numVoluntarySwitches++;
+	}
+	RecordStats(oldThread);
+	if (trace != NULL)
+	    trace->Record(TraceSwitch, preempting, nextThread->getPid());
+    }
+    preempting = false;
+    RecordStats(nextThread);
+
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+
+    // nextThread starts a new time slice
+    if (timeSlicer != NULL)
+	timeSlicer->Disarm();
+    ArmSlice();
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
@@ -129,7 +285,14 @@ Scheduler::Run (Thread *nextThread)
     // a bit to figure out what happens after this, both from the point
     // of view of the thread and from the perspective of the "outside world".
 
+    // Lo que estaba haciendo el hilo (para el perfil del host, -hp)
+    // vuelve a valer cuando retoma la CPU.
+    int activity = stats->hostActivity;
+    const char *label = stats->hostLabel;
+    
+    SetHostActivity(HostKernel, "kernel threads");
     SWITCH(oldThread, nextThread);
+    SetHostActivity(activity, label);
     
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->getName());
 
@@ -156,58 +319,456 @@ Scheduler::Run (Thread *nextThread)
 //	the ready list.  For debugging.
 //----------------------------------------------------------------------
 
-static void
-ThreadPrint (Thread* t) {
-  t->Print();
-}
-
 void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
+    if (policy == StrideScheduling)
+    {
+		for (int i = 0; i < heapSize; i++)
+			printf("%s (pass %lld), ", heap[i]->getName(), heap[i]->pass);
+		printf("\n");
+		return;
+	}
     for (int i = 0; i < MAX_PRIORITY; i++)
     {
-		if (!readyList[i]->IsEmpty())
+		if (readyHead[i] != NULL)
 		{
 			printf("Threads with priority %d: ", i);
-			readyList[i]->Apply(ThreadPrint);
+			for (Thread *t = readyHead[i]; t != NULL; t = t->readyNext)
+				t->Print();
 			printf("\n");
 		}
 	}
 }
 
+//----------------------------------------------------------------------
+// Scheduler::PrintStats
+// 	Con MLFQ, mostramos cuánto usó la CPU el hilo, cuánto esperó en la
+//	cola de listos y en qué nivel terminó.  Se llama cuando el hilo
+//	termina.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintStats(Thread *thread)
+{
+	if (policy != FeedbackQueues)
+		return;
+	printf("Thread \"%s\": cpu %d, ready wait %d, level %d\n",
+		thread->getName(),
+		thread->cpuTicks + stats->totalTicks - thread->runningSince,
+		thread->waitTicks, thread->getInitialPriority());
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ChangePriority
-// 	Cambiamos de cola al thread de acuerdo a su prioridad.
+// 	Le damos al thread la prioridad "priority" y lo cambiamos de cola.
+//	Si el hilo no está listo (está bloqueado o corriendo) no está en
+//	ninguna cola: solo cambiamos su prioridad, que se usa la próxima
+//	vez que se encole.
 //----------------------------------------------------------------------
 
 void
-Scheduler::ChangePriority(Thread* thread)
+Scheduler::ChangePriority(Thread* thread, int priority)
 {
-	Thread *first, *temp;
+	// Por pasos, las prioridades no deciden nada (y los hilos listos
+	// están en el heap, no en las colas).
+	if (thread->getStatus() != READY || policy == StrideScheduling)
+	{
+		thread->setPriority(priority);
+		return;
+	}
+	
+	// Lo sacamos de su cola en O(1) y lo insertamos en la cola
+	// correspondiente a su nueva prioridad.
+	Unlink(thread, thread->getPriority());
+	thread->setPriority(priority);
+	Enqueue(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetLevel
+// 	Cambiamos el nivel (la prioridad inicial) del hilo.  Si tiene
+//	prestada una prioridad mayor (ver Lock), la conserva hasta que
+//	libere el lock.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetLevel(Thread *thread, int level)
+{
+	bool inherited = thread->getPriority() > thread->getInitialPriority();
+	
+	thread->setInitialPriority(level);
+	if (!inherited || level > thread->getPriority())
+		ChangePriority(thread, level);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumExpired
+// 	El hilo actual usó todo su quantum: con MLFQ lo bajamos un nivel.
+//	Aprovechamos también para envejecer la cola de listos.  Se llama
+//	desde el manejador del timer, antes de hacer YieldOnReturn.
+//----------------------------------------------------------------------
+
+void
+Scheduler::QuantumExpired()
+{
+	if (policy != FeedbackQueues)
+		return;
+	
+	if (currentThread->getInitialPriority() > 0)
+	{
+		SetLevel(currentThread, currentThread->getInitialPriority() - 1);
+		DEBUG('t', "\"%s\" used its quantum, now at level %d\n",
+			currentThread->getName(), currentThread->getInitialPriority());
+	}
 	
-	// Buscamos el thread dentro de cada lista; al encontrarlo,
-	// lo sacamos.
-	for (int i = 0; i < MAX_PRIORITY; i++)
+	if (stats->totalTicks - lastAging >= AGING_TICKS)
 	{
-		if (!readyList[i]->IsEmpty())
+		Age();
+		lastAging = stats->totalTicks;
+	}
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Age
+// 	Subimos un nivel a los hilos que están en la cola de listos hace
+//	AGING_TICKS o más.  Recorremos los niveles de arriba hacia abajo,
+//	así cada hilo sube a lo sumo uno.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Age()
+{
+	for (int i = MAX_PRIORITY - 2; i >= 0; i--)
+	{
+		Thread *next;
+		for (Thread *t = readyHead[i]; t != NULL; t = next)
 		{
-			first = readyList[i]->Remove();
-			readyList[i]->Append(first);
-			do
-			{
-				temp = readyList[i]->Remove();
-				if (thread != temp)
-				{
-					readyList[i]->Append(temp);
-				}
-			} while (temp != first);
+			next = t->readyNext;
+			if (stats->totalTicks - t->readySince >= AGING_TICKS
+				&& t->getInitialPriority() < MAX_PRIORITY - 1)
+				SetLevel(t, t->getInitialPriority() + 1);
 		}
 	}
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetPolicy
+// 	Elegimos la política de planificación, con su quantum por omisión.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetPolicy(SchedulingPolicy p)
+{
+	policy = p;
+	if (policy == FeedbackQueues)
+		quantum = FEEDBACK_QUANTUM;
+	else if (policy == StrideScheduling)
+		quantum = STRIDE_QUANTUM;
+	else
+		quantum = STATIC_QUANTUM;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Quantum
+// 	Devolvemos el quantum (en ticks) del hilo.  Con MLFQ, los niveles
+//	más bajos, que son los de los hilos que más usan la CPU, tienen
+//	quantums más largos, así se los interrumpe menos.
+//----------------------------------------------------------------------
+
+int
+Scheduler::Quantum(Thread *thread)
+{
+	if (policy == FeedbackQueues)
+		return quantum * (MAX_PRIORITY - thread->getInitialPriority());
+	return quantum;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ArmSlice
+// 	Programamos el fin del quantum del hilo actual, si hay un timer
+//	para eso (timeSlicer).  Si no hay ningún otro hilo listo, no hay
+//	con quién repartir la CPU y no programamos nada: el timer no
+//	interrumpe hasta que otro hilo esté listo (ver ReadyToRun).
+//----------------------------------------------------------------------
+
+void
+Scheduler::ArmSlice()
+{
+	if (timeSlicer == NULL || timeSlicer->IsArmed())
+		return;
+	if (!AnyReady())
+		return;
+	
+	// Descontamos lo que el hilo ya corrió de este quantum.
+	int left = Quantum(currentThread) 
+		- (stats->totalTicks - currentThread->runningSince);
+	timeSlicer->Arm(left > 0 ? left : 1);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Le cobramos al hilo la CPU que usó desde que empezó a correr (o
+//	desde el último cobro).  Por pasos, además avanzamos su pass.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+	int used = stats->totalTicks - thread->runningSince;
+	
+	thread->cpuTicks += used;
+	thread->runningSince = stats->totalTicks;
+	if (policy == StrideScheduling)
+		thread->pass += (long long) (STRIDE1 / thread->tickets) * used;
+	RecordStats(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Precedes
+// 	Devolvemos true si el hilo "a" tiene que correr antes que "b": por
+//	pasos, si su pass es menor; si no, si su prioridad es mayor.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Precedes(Thread *a, Thread *b)
+{
+	if (policy == StrideScheduling)
+		return a->pass < b->pass;
+	return a->getPriority() > b->getPriority();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapLess
+// 	Orden del heap: menor pass primero y, a igual pass, el que espera
+//	hace más tiempo.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::HeapLess(int i, int j)
+{
+	if (heap[i]->pass != heap[j]->pass)
+		return heap[i]->pass < heap[j]->pass;
+	return heap[i]->readySince < heap[j]->readySince;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapInsert
+// 	Agregamos el hilo al heap de listos, agrandándolo si hace falta.
+//----------------------------------------------------------------------
+
+void
+Scheduler::HeapInsert(Thread *thread)
+{
+	if (heapSize == heapCapacity)
+	{
+		Thread **bigger = new Thread *[2 * heapCapacity];
+		for (int i = 0; i < heapSize; i++)
+			bigger[i] = heap[i];
+		delete [] heap;
+		heap = bigger;
+		heapCapacity *= 2;
+	}
 	
-	// Obtenemos y verificamos la prioridad de thread.
-	int priority = thread->getPriority();
-	ASSERT(0 <= priority && priority < MAX_PRIORITY);
-	// Insertamos thread en la cola correspondiente a su prioridad.
-	readyList[priority]->Append(thread);
+	// Lo ponemos al final y lo subimos mientras sea menor que su padre.
+	int i = heapSize++;
+	heap[i] = thread;
+	while (i > 0 && HeapLess(i, (i - 1) / 2))
+	{
+		Thread *t = heap[i];
+		heap[i] = heap[(i - 1) / 2];
+		heap[(i - 1) / 2] = t;
+		i = (i - 1) / 2;
+	}
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapRemoveMin
+// 	Sacamos del heap (que no puede estar vacío) el hilo de menor pass.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::HeapRemoveMin()
+{
+	Thread *min = heap[0];
+	int i = 0;
+	
+	ASSERT(heapSize > 0);
+	heap[0] = heap[--heapSize];
+	
+	// Bajamos el último hilo mientras alguno de sus hijos sea menor.
+	for (;;)
+	{
+		int smallest = i;
+		int left = 2 * i + 1, right = 2 * i + 2;
+		if (left < heapSize && HeapLess(left, smallest))
+			smallest = left;
+		if (right < heapSize && HeapLess(right, smallest))
+			smallest = right;
+		if (smallest == i)
+			break;
+		Thread *t = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = t;
+		i = smallest;
+	}
+	return min;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetTickets
+// 	Cambiamos la cantidad de tickets del hilo, entre 1 y MAX_TICKETS.
+//	El pass ya acumulado no cambia; de ahora en más avanza según los
+//	nuevos tickets.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetTickets(Thread *thread, int tickets)
+{
+	ASSERT(0 < tickets && tickets <= MAX_TICKETS);
+	// Si está compitiendo, cerramos el intervalo con los tickets viejos
+	// y empezamos otro con los nuevos.
+	if (thread->competing)
+	{
+		StopCompeting(thread);
+		thread->tickets = tickets;
+		StartCompeting(thread);
+	}
+	else
+		thread->tickets = tickets;
+	RecordStats(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RecordStats
+// 	Copiamos los tiempos, cambios de contexto y tickets del hilo a
+//	stats, donde quedan después de que el hilo termine.  La primera
+//	vez le pedimos un lugar; si no queda, no los guardamos.
+//----------------------------------------------------------------------
+
+void
+Scheduler::RecordStats(Thread *thread)
+{
+	if (thread->record == NULL)
+	{
+		thread->record = stats->NewThreadStats(thread->getName());
+		if (thread->record == NULL)
+			return;
+	}
+	thread->record->cpuTicks = thread->cpuTicks;
+	thread->record->waitTicks = thread->waitTicks;
+	thread->record->voluntarySwitches = thread->voluntarySwitches;
+	thread->record->involuntarySwitches = thread->involuntarySwitches;
+	thread->record->tickets = thread->tickets;
+	thread->record->requestedTicks = thread->requestedTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::AdvanceShares
+// 	Repartimos el tiempo que pasó desde la última vez entre los
+//	tickets de los hilos que compiten: ticksPerTicket es cuánta CPU le
+//	correspondió, desde el arranque, a un ticket que compitió siempre.
+//----------------------------------------------------------------------
+
+void
+Scheduler::AdvanceShares()
+{
+	if (competingTickets > 0)
+		ticksPerTicket += (double) (stats->totalTicks - sharesUpdated)
+			/ competingTickets;
+	sharesUpdated = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::StartCompeting, Scheduler::StopCompeting
+// 	El hilo empieza o deja de competir por la CPU.  Mientras compite,
+//	le corresponde la parte de la CPU de sus tickets sobre los de todos
+//	los que compiten; al dejar de competir, sumamos esa parte a
+//	requestedTicks.
+//----------------------------------------------------------------------
+
+void
+Scheduler::StartCompeting(Thread *thread)
+{
+	ASSERT(!thread->competing);
+	AdvanceShares();
+	thread->competing = true;
+	thread->shareMark = ticksPerTicket;
+	competingTickets += thread->tickets;
+}
+
+void
+Scheduler::StopCompeting(Thread *thread)
+{
+	if (!thread->competing)
+		return;
+	AdvanceShares();
+	thread->requestedTicks += thread->tickets
+		* (ticksPerTicket - thread->shareMark);
+	thread->competing = false;
+	competingTickets -= thread->tickets;
+	RecordStats(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Preempt
+// 	El hilo actual cede la CPU porque se terminó su quantum (o por
+//	-rs).  Lo anotamos para que Run cuente el cambio de contexto como
+//	involuntario.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Preempt()
+{
+	preempting = true;
+	currentThread->Yield();
+	preempting = false;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintShares
+// 	Por pasos, mostramos para cada hilo la parte de la CPU que pidió
+//	y la que obtuvo (sus ticks de CPU sobre el total).  La pedida es
+//	la que le correspondía por sus tickets en cada momento en que
+//	estuvo listo o corriendo, frente a los tickets de los demás hilos
+//	que competían en ese momento (ver StartCompeting); así un hilo no
+//	le "pide" CPU a hilos que ya terminaron o todavía no existían.
+//	Se llama al hacer Halt.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintShares()
+{
+	ThreadStats *shares = stats->threadStats;
+	double totalRequested = 0;
+	int totalTicks = 0;
+	
+	if (policy != StrideScheduling)
+		return;
+	
+	// Cerramos el intervalo de los que todavía compiten.
+	if (currentThread->competing)
+	{
+		StopCompeting(currentThread);
+		StartCompeting(currentThread);
+	}
+	for (int i = 0; i < heapSize; i++)
+	{
+		StopCompeting(heap[i]);
+		StartCompeting(heap[i]);
+	}
+	
+	for (int i = 0; i < stats->numThreadStats; i++)
+	{
+		totalRequested += shares[i].requestedTicks;
+		totalTicks += shares[i].cpuTicks;
+	}
+	printf("CPU shares (requested, by tickets while ready or running / "
+		"achieved):\n");
+	for (int i = 0; i < stats->numThreadStats; i++)
+		printf("%s: tickets %d, %.1f%% / %.1f%%\n", shares[i].name,
+			shares[i].tickets, totalRequested ?
+			100.0 * shares[i].requestedTicks / totalRequested : 0.0,
+			totalTicks ? 100.0 * shares[i].cpuTicks / totalTicks : 0.0);
 }
@@ -11,6 +11,30 @@
 
 #define MAX_PRIORITY 10
 
+// Con colas multinivel con realimentación, cada cuántos ticks subimos
+// un nivel a los hilos que esperan en la cola de listos hace tanto o más.
+#define AGING_TICKS 5000
+
+// Quantum por omisión (en ticks) de cada política; se puede cambiar con
+// -q (ver system.cc).  Con MLFQ es el quantum del nivel más alto, y
+// cada nivel más abajo recibe uno más.
+#define STATIC_QUANTUM 1000
+#define FEEDBACK_QUANTUM 500
+#define STRIDE_QUANTUM 100
+
+// Planificación por pasos (stride scheduling): cada hilo recibe una
+// parte de la CPU proporcional a sus tickets.  STRIDE1 es el paso de un
+// hilo con un solo ticket.
+#define DEFAULT_TICKETS 100
+#define MAX_TICKETS 10000
+#define STRIDE1 (1 << 20)
+
+// Políticas de planificación (se elige al arrancar, ver system.cc):
+// prioridades fijas, colas multinivel con realimentación (MLFQ), en
+// las que la prioridad de cada hilo cambia según su comportamiento, o
+// por pasos, en la que se ignoran las prioridades.
+enum SchedulingPolicy { StaticPriorities, FeedbackQueues, StrideScheduling };
+
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
@@ -29,12 +53,78 @@ class Scheduler {
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
-    // Cambiamos de lista al hilo de acuerdo a su prioridad.
-    void ChangePriority(Thread* thread);
+    // Cambiamos la prioridad del hilo y, si está listo, su cola.
+    void ChangePriority(Thread* thread, int priority);
+    
+    void SetPolicy(SchedulingPolicy p);
+    void SetQuantum(int ticks) { ASSERT(ticks > 0); quantum = ticks; }
+    int Quantum(Thread *thread);	// Quantum que le toca al hilo
+    SchedulingPolicy GetPolicy() { return policy; }
+    void PrintStats(Thread *thread);	// Tiempos del hilo (con MLFQ)
+    // El hilo actual usó todo su quantum (lo llama el timer).
+    void QuantumExpired();
+    
+    // Cobramos al hilo la CPU que usó desde runningSince.
+    void Charge(Thread *thread);
+    // ¿Tiene que correr "a" antes que "b"?
+    bool Precedes(Thread *a, Thread *b);
+    
+    // Tickets del hilo (planificación por pasos).
+    void SetTickets(Thread *thread, int tickets);
+    void PrintShares();			// Parte de la CPU pedida y obtenida
+    
+    // El hilo empieza o deja de competir por la CPU (queda listo, o
+    // se bloquea o termina).
+    void StartCompeting(Thread *thread);
+    void StopCompeting(Thread *thread);
+    
+    // Un hilo va a ceder la CPU porque lo desalojaron (lo llama
+    // Interrupt::OneTick en lugar de Yield).
+    void Preempt();
+    
+    // Copiamos las estadísticas del hilo a las de Nachos (stats).
+    void RecordStats(Thread *thread);
     
   private:
-	// List of threads that are ready to run, but not running
-	List<Thread*> *readyList[MAX_PRIORITY];
+	SchedulingPolicy policy;
+	int lastAging;			// última vez que envejecimos la cola
+	int quantum;
+	
+	bool AnyReady() { return readyMask != 0 || heapSize != 0; }
+	void ArmSlice();
+	
+	// Planificación por pasos: heap de hilos listos ordenado por pass,
+	// y pass del último hilo despachado.
+	Thread **heap;
+	int heapSize, heapCapacity;
+	long long globalPass;
+	
+	// Tickets de los hilos que compiten por la CPU, y CPU que le
+	// correspondió a cada ticket desde el arranque (hasta sharesUpdated).
+	int competingTickets;
+	double ticksPerTicket;
+	int sharesUpdated;
+	void AdvanceShares();
+	void HeapInsert(Thread *thread);
+	Thread *HeapRemoveMin();
+	bool HeapLess(int i, int j);
+	
+	// ¿El cambio de contexto en curso es un desalojo?
+	bool preempting;
+	
+
+	// Threads that are ready to run, but not running: one FIFO queue
+	// per priority, doubly linked through Thread::readyNext/readyPrev.
+	Thread *readyHead[MAX_PRIORITY];
+	Thread *readyTail[MAX_PRIORITY];
+	// Bit i is set when the queue of priority i is not empty.
+	unsigned int readyMask;
+	
+	void Enqueue(Thread *thread);
+	Thread *Dequeue(int priority);
+	void Unlink(Thread *thread, int priority);
+	void SetLevel(Thread *thread, int level);
+	void Age();
 };
 
 #endif // SCHEDULER_H
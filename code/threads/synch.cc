@@ -25,6 +25,51 @@
 #include "synch.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// AccountWait
+// 	Add the time a thread was just blocked, since "blockedAt", to the
+//	statistics "s" of a synchronization object.
+//----------------------------------------------------------------------
+
+static void
+AccountWait(SyncStats *s, int blockedAt)
+{
+    int ticks = stats->totalTicks - blockedAt;
+
+    s->numWaits++;
+    s->blockedTicks += ticks;
+    if (ticks > s->maxBlockedTicks)
+	s->maxBlockedTicks = ticks;
+}
+
+//----------------------------------------------------------------------
+// CountAcquire, CountHold, CountBoost
+// 	When profiling synchronization (-lp), count an acquisition of an
+//	object, the time a lock was held since "heldAt", or a priority
+//	boost given to the holder of a lock.
+//----------------------------------------------------------------------
+
+static void
+CountAcquire(SyncStats *s)
+{
+    if (stats->profileSync)
+	s->numAcquires++;
+}
+
+static void
+CountHold(SyncStats *s, int heldAt)
+{
+    if (stats->profileSync)
+	s->holdTicks += stats->totalTicks - heldAt;
+}
+
+static void
+CountBoost(SyncStats *s)
+{
+    if (stats->profileSync)
+	s->numBoosts++;
+}
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -37,7 +82,7 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread*>;
+    syncStats = new SyncStats("semaphore", debugName);
 }
 
 //----------------------------------------------------------------------
@@ -48,7 +93,7 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
 
 Semaphore::~Semaphore()
 {
-    delete queue;
+    SyncStats::Discard(syncStats);
 }
 
 //----------------------------------------------------------------------
@@ -59,6 +104,10 @@ Semaphore::~Semaphore()
 //
 //	Note that Thread::Sleep assumes that interrupts are disabled
 //	when it is called.
+//
+//	If the semaphore is available, this only decrements the value;
+//	waiting threads are queued through Thread::queueNext, so blocking
+//	does not allocate anything either.
 //----------------------------------------------------------------------
 
 void
@@ -66,11 +115,22 @@ Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
     
+    CountAcquire(syncStats);
+    if (value > 0) {				// the common case
+	value--;
+	interrupt->SetLevel(oldLevel);
+	return;
+    }
+
+    int blockedAt = stats->totalTicks;
+
     while (value == 0) { 			// semaphore not available
     DEBUG('t', "Sent \"%s\" to sleep using \"%s\"\n", currentThread->getName(), getName());
-	queue->Append(currentThread);		// so go to sleep
+	queue.Append(currentThread);		// so go to sleep
 	currentThread->Sleep();
     } 
+    AccountWait(syncStats, blockedAt);	// account for the time
+						// blocked
     value--; 					// semaphore available, 
 						// consume its value
     
@@ -91,7 +151,7 @@ Semaphore::V()
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = queue->Remove();
+    thread = queue.Remove();
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
     value++;
@@ -112,10 +172,15 @@ Semaphore::V()
 Lock::Lock(const char* debugName)
 {
 	name = debugName;
-	// Inicializamos el semáforo en 1
-	sem = new Semaphore("Lock Semaphore", 1);
+	// Inicializamos el semáforo en 1. Tiene sus propias estadísticas;
+	// las del lock las lleva Acquire.
+	sem = new Semaphore(debugName, 1);
 	// Inicializamos el dueño en NULL
 	owner = NULL;
+	waiters = NULL;
+	nextHeld = NULL;
+	acquiredAt = 0;
+	syncStats = new SyncStats("lock", debugName);
 }
 
 //----------------------------------------------------------------------
@@ -126,15 +191,61 @@ Lock::Lock(const char* debugName)
 Lock::~Lock()
 {
 	delete sem;
+	SyncStats::Discard(syncStats);
+}
+
+//----------------------------------------------------------------------
+// Lock::MaxWaiterPriority
+//  Devolvemos la mayor prioridad entre los hilos bloqueados en el
+//  lock, o -1 si no hay ninguno.
+//----------------------------------------------------------------------
+
+int Lock::MaxWaiterPriority()
+{
+	int max = -1;
+	
+	for (Thread *t = waiters; t != NULL; t = t->waitNext)
+		if (t->getPriority() > max)
+			max = t->getPriority();
+	return max;
+}
+
+//----------------------------------------------------------------------
+// RecomputePriority
+//  La prioridad de un hilo es la mayor entre su prioridad inicial,
+//  la de los hilos bloqueados en alguno de los locks que tiene y la
+//  que le prestan los escritores de los RWLock que tiene para leer.
+//----------------------------------------------------------------------
+
+static void
+RecomputePriority(Thread *thread)
+{
+	int priority = thread->getInitialPriority();
+	
+	for (Lock *l = thread->heldLocks; l != NULL; l = l->nextHeld)
+		if (l->MaxWaiterPriority() > priority)
+			priority = l->MaxWaiterPriority();
+	for (int i = 0; i < thread->numReadLocks; i++)
+		if (thread->readLocks[i]->DrainPriority() > priority)
+			priority = thread->readLocks[i]->DrainPriority();
+	
+	if (priority != thread->getPriority())
+	{
+		scheduler->ChangePriority(thread, priority);
+		DEBUG('t', "\"%s\" now has priority \"%d\"\n", 
+			thread->getName(), thread->getPriority());
+	}
 }
 
 //----------------------------------------------------------------------
 // Lock::Acquire
 //  El hilo adquiere el lock. Si el lock ya está tomado, mandamos a
 //  dormir el hilo que trata de tomarlo a través del semáforo.
-//  Además, si el lock está tomado por el hilo owner y un nuevo hilo
-//  con mayor prioridad trata de tomar el lock, hacemos inversión de 
-//  prioridades. 
+//  Además, si el lock está tomado por un hilo de menor prioridad, le
+//  prestamos nuestra prioridad (inversión de prioridades). Si ese
+//  hilo a su vez está bloqueado en otro lock, el préstamo sigue por
+//  la cadena de dueños, así ninguno queda postergado por un hilo de
+//  prioridad intermedia.
 //----------------------------------------------------------------------
 
 void Lock::Acquire() 
@@ -142,16 +253,29 @@ void Lock::Acquire()
 	// Hacemos ASSERT para evitar Acquires anidados.
 	ASSERT(!isHeldByCurrentThread());
 	
-	// Si el hilo dueño tiene menor prioridad, le damos la prioridad del
-	// hilo actual y cambiamos su lugar en la multicola del scheduler.
+	// Deshabilitamos interrupciones para que la cadena de dueños no
+	// cambie mientras la recorremos.
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	int blockedAt = stats->totalTicks;
+	
+	CountAcquire(syncStats);
 	if (owner != NULL)
 	{
-		if (owner->getPriority() < currentThread->getPriority())
+		// Nos anotamos como esperando el lock.
+		currentThread->blockedOn = this;
+		currentThread->waitNext = waiters;
+		waiters = currentThread;
+		
+		// Propagamos nuestra prioridad por la cadena de dueños.
+		for (Lock *l = this; l != NULL && l->owner != NULL;
+			l = l->owner->blockedOn)
 		{
-			owner->setPriority(currentThread->getPriority());
-			scheduler->ChangePriority(owner);
+			if (l->owner->getPriority() >= currentThread->getPriority())
+				break;
+			scheduler->ChangePriority(l->owner, currentThread->getPriority());
+			CountBoost(l->syncStats);
 			DEBUG('t', "\"%s\" now has priority \"%d\"\n", 
-				owner->getName(), owner->getPriority());
+				l->owner->getName(), l->owner->getPriority());
 		}
 	}
 	
@@ -159,18 +283,43 @@ void Lock::Acquire()
 	// currentThread se va a dormir.
 	sem->P();
 	
-	// Seteamos el dueño del lock.
+	// Si estuvimos esperando, salimos de la lista de espera.
+	if (currentThread->blockedOn != NULL)
+	{
+		AccountWait(syncStats, blockedAt);
+		Thread **t = &waiters;
+		while (*t != currentThread)
+			t = &(*t)->waitNext;
+		*t = currentThread->waitNext;
+		currentThread->waitNext = NULL;
+		currentThread->blockedOn = NULL;
+	}
+	
+	// Seteamos el dueño del lock y lo agregamos a sus locks.
 	owner = currentThread;
+	nextHeld = owner->heldLocks;
+	owner->heldLocks = this;
+	
+	acquiredAt = stats->totalTicks;
+	
+	// Los que siguen esperando le prestan su prioridad al nuevo dueño.
+	if (MaxWaiterPriority() > owner->getPriority())
+	{
+		RecomputePriority(owner);
+		CountBoost(syncStats);
+	}
 	
 	DEBUG('t', "\"%s\" is currently holding \"%s\"\n", owner->getName(), 
 		getName());
+	(void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
 //  El hilo dueño libera el lock.
-//  Si hubo inversión de prioridades, seteamos la prioridad del hilo
-//  dueño a la inicial.
+//  Si hubo inversión de prioridades, recalculamos la prioridad del
+//  hilo dueño: vuelve a la inicial, salvo que algún otro lock que
+//  todavía tiene lo espere un hilo de mayor prioridad.
 //----------------------------------------------------------------------
 
 void Lock::Release()
@@ -180,15 +329,20 @@ void Lock::Release()
 	DEBUG('t', "\"%s\" has released \"%s\"\n", owner->getName(), 
 		getName());
 	
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	CountHold(syncStats, acquiredAt);
+	
+	// Sacamos el lock de la lista de locks del dueño.
+	Lock **l = &owner->heldLocks;
+	while (*l != this)
+		l = &(*l)->nextHeld;
+	*l = nextHeld;
+	nextHeld = NULL;
+	
 	// Si la prioridad inicial del hilo dueño es distinta a la actual,
-	// hubo inversión de prioridades y hacemos que la prioridad del hilo
-	// vuelva a la inicial. 
+	// hubo inversión de prioridades y la recalculamos.
 	if (owner->getInitialPriority() != owner->getPriority())
-	{
-		owner->setPriority(owner->getInitialPriority());
-		DEBUG('t', "\"%s\" has returned to its original priority \"%d\"\n", 
-			owner->getName(), owner->getPriority());
-	}
+		RecomputePriority(owner);
 	
 	// Seteamos el dueño en NULL. Lo hacemos antes de liberar el lock,
 	// ya que si no lo hacemos puede haber cambio de contexto y
@@ -198,6 +352,7 @@ void Lock::Release()
 	// Liberamos el lock. Incrementamos el semáforo y despertamos a
 	// algún hilo que se haya bloqueado con Acquire.
 	sem->V();
+	(void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -222,79 +377,80 @@ Condition::Condition(const char* debugName, Lock* conditionLock)
 {
 	name = debugName;
 	lock = conditionLock;
-	semList = new List<Semaphore*>;
+	syncStats = new SyncStats("condition", debugName);
 }
 
 //----------------------------------------------------------------------
 // Condition::~Condition
-//  Liberamos la variable de condición. Destruimos la lista de
-//  semáforos.
+//  Liberamos la variable de condición. Suponemos que ya no hay nadie
+//  esperando.
 //----------------------------------------------------------------------
 
 Condition::~Condition()
 {
 	lock = NULL;
-	delete semList;
+	SyncStats::Discard(syncStats);
 }
 
 //----------------------------------------------------------------------
 // Condition::Wait
-//  Bloqueamos al dueño del lock con el semáforo creado. Luego al salir
-//  de P(), el hilo vuelve a tomar el lock.
+//  Encolamos al dueño del lock, liberamos el lock y lo mandamos a
+//  dormir. Al despertarse, el hilo vuelve a tomar el lock.
+//  No se pide memoria: el hilo se encola por Thread::queueNext.
 //----------------------------------------------------------------------
 
 void Condition::Wait()
 {
-	Semaphore* sem;
 	// ASSERT para chequear que el Wait lo llame el dueño del lock.
 	ASSERT(lock->isHeldByCurrentThread());
 	
-	// Creamos el semáforo para bloquear al dueño de lock.
-	sem = new Semaphore("CV Semaphore", 0);
-	semList->Append(sem);
-	// Liberamos el lock.
+	// Deshabilitamos interrupciones para que nadie haga Signal entre
+	// que liberamos el lock y nos dormimos.
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	int blockedAt = stats->totalTicks;
+	
+	CountAcquire(syncStats);
+	queue.Append(currentThread);
 	lock->Release();
-	// Bloqueamos al dueño de lock y luego liberamos la memoria del sem.
-	sem->P();
-	delete sem;
+	currentThread->Sleep();
+	AccountWait(syncStats, blockedAt);
+	(void) interrupt->SetLevel(oldLevel);
+	
 	// Al despertarse, el hilo vuelve a tomar el lock.
 	lock->Acquire();
 }
 
 //----------------------------------------------------------------------
 // Condition::Signal
-//  Despertamos al hilo del primer semáforo de la lista, mandado a
-//  dormir con P() en Wait.
+//  Despertamos al primer hilo de la cola, mandado a dormir en Wait.
 //----------------------------------------------------------------------
 
 void Condition::Signal()
 {
-	Semaphore* sem;
+	Thread *thread;
 	ASSERT(lock->isHeldByCurrentThread());
-	// Despertamos el hilo del primer semáforo.
-	if (!semList->IsEmpty())
-	{
-		sem = semList->Remove();
-		sem->V();
-	}
+	
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	thread = queue.Remove();
+	if (thread != NULL)
+		scheduler->ReadyToRun(thread);
+	(void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-//  Despertamos a todos los hilos de todos los semáforos de la lista,
-//  mandados a dormir con P() en Wait.
+//  Despertamos a todos los hilos de la cola, mandados a dormir en Wait.
 //----------------------------------------------------------------------
 
 void Condition::Broadcast()
 {
-	Semaphore* sem;
+	Thread *thread;
 	ASSERT(lock->isHeldByCurrentThread());
-	// Recorremos la lista de semáforos y despertamos a todos los hilos.
-	while (!semList->IsEmpty())
-	{
-		sem = semList->Remove();
-		sem->V();
-	}
+	
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	while ((thread = queue.Remove()) != NULL)
+		scheduler->ReadyToRun(thread);
+	(void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -395,3 +551,314 @@ void Port::Receive(int *message)
 	
 	lock->Release();
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+//  Inicializamos el cerrojo de lectores/escritores, libre.
+//
+//  "debugName" nombre arbitrario del cerrojo.
+//  "pref" a quién se favorece cuando hay lectores y escritores
+//  esperando (ver synch.h).
+//----------------------------------------------------------------------
+
+RWLock::RWLock(const char* debugName, RWPreference pref)
+{
+	name = debugName;
+	preference = pref;
+	// El lock lleva el mismo nombre; sus estadísticas son aparte.
+	lock = new Lock(debugName);
+	readers = 0;
+	maxReaders = 4;
+	readerThreads = new Thread*[maxReaders];
+	drainPriority = -1;
+	syncStats = new SyncStats("rwlock", debugName);
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+//  Liberamos el cerrojo. Nadie debe tenerlo ni estar esperándolo.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+	ASSERT(readers == 0);
+	delete [] readerThreads;
+	delete lock;
+	SyncStats::Discard(syncStats);
+}
+
+//----------------------------------------------------------------------
+// RWLock::Lend
+//  Le prestamos "priority" al lector "thread", si tiene menos.
+//----------------------------------------------------------------------
+
+void RWLock::Lend(Thread *thread, int priority)
+{
+	if (thread->getPriority() >= priority)
+		return;
+	scheduler->ChangePriority(thread, priority);
+	CountBoost(syncStats);
+	DEBUG('t', "\"%s\" now has priority \"%d\"\n", 
+		thread->getName(), thread->getPriority());
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+//  El hilo toma el cerrojo para leer. Pasamos por el lock: si lo tiene
+//  un escritor, esperamos (y le prestamos nuestra prioridad) hasta que
+//  termine. Una vez contados, lo soltamos, así pueden entrar otros
+//  lectores. Si hay escritores esperando que salgan los lectores (con
+//  preferencia por lectores), nos prestan su prioridad.
+//----------------------------------------------------------------------
+
+void RWLock::AcquireRead()
+{
+	lock->Acquire();
+	
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	if (readers == maxReaders)
+	{
+		Thread **more = new Thread*[2 * maxReaders];
+		for (int i = 0; i < readers; i++)
+			more[i] = readerThreads[i];
+		delete [] readerThreads;
+		readerThreads = more;
+		maxReaders *= 2;
+	}
+	readerThreads[readers++] = currentThread;
+	
+	// También lo anotamos en el hilo (ver RecomputePriority).
+	if (currentThread->numReadLocks == currentThread->maxReadLocks)
+	{
+		int max = (currentThread->maxReadLocks > 0) ?
+			2 * currentThread->maxReadLocks : 4;
+		RWLock **more = new RWLock*[max];
+		for (int i = 0; i < currentThread->numReadLocks; i++)
+			more[i] = currentThread->readLocks[i];
+		delete [] currentThread->readLocks;
+		currentThread->readLocks = more;
+		currentThread->maxReadLocks = max;
+	}
+	currentThread->readLocks[currentThread->numReadLocks++] = this;
+	Lend(currentThread, drainPriority);
+	(void) interrupt->SetLevel(oldLevel);
+	
+	lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+//  El hilo suelta el cerrojo de lectura y devuelve la prioridad que le
+//  hayan prestado. Si es el último lector, despertamos a los escritores
+//  que esperaban que salieran.
+//----------------------------------------------------------------------
+
+void RWLock::ReleaseRead()
+{
+	Thread *thread;
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	
+	ASSERT(readers > 0);
+	int i = 0;
+	while (readerThreads[i] != currentThread)
+		i++;
+	readerThreads[i] = readerThreads[--readers];
+	RWLock **r = currentThread->readLocks;
+	for (i = 0; r[i] != this; i++)
+		;
+	r[i] = r[--currentThread->numReadLocks];
+	
+	// Si hubo préstamo, volvemos a la prioridad que nos dan los locks
+	// y los RWLock que todavía tenemos (ver Lock::Release).
+	if (currentThread->getInitialPriority() != currentThread->getPriority())
+		RecomputePriority(currentThread);
+	
+	if (readers == 0)
+	{
+		while ((thread = drainQueue.Remove()) != NULL)
+			scheduler->ReadyToRun(thread);
+		drainPriority = -1;
+	}
+	(void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+//  El hilo toma el cerrojo para escribir: primero el lock, que excluye
+//  a los otros escritores y a los lectores nuevos, y luego esperamos a
+//  que salgan los lectores que ya estaban.
+//  Con preferencia por lectores, soltamos el lock mientras esperamos,
+//  para que puedan seguir entrando lectores, y lo volvemos a tomar
+//  antes de mirar otra vez.
+//----------------------------------------------------------------------
+
+void RWLock::AcquireWrite()
+{
+	lock->Acquire();
+	
+	// Con las interrupciones deshabilitadas, ningún lector puede salir
+	// entre que miramos readers y nos dormimos.
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	
+	if (readers > 0)
+	{
+		int blockedAt = stats->totalTicks;
+		
+		while (readers > 0)
+		{
+			if (preference == PreferReaders)
+				lock->Release();
+			// Les prestamos nuestra prioridad a los lectores, para
+			// que no los posterguen hilos de prioridad intermedia.
+			if (currentThread->getPriority() > drainPriority)
+				drainPriority = currentThread->getPriority();
+			for (int i = 0; i < readers; i++)
+				Lend(readerThreads[i], drainPriority);
+			drainQueue.Append(currentThread);
+			currentThread->Sleep();
+			if (preference == PreferReaders)
+				lock->Acquire();
+		}
+		AccountWait(syncStats, blockedAt);
+	}
+	(void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+//  El escritor suelta el cerrojo. Soltar el lock despierta al próximo
+//  que espera, sea lector o escritor, y le devuelve al escritor su
+//  prioridad.
+//----------------------------------------------------------------------
+
+void RWLock::ReleaseWrite()
+{
+	ASSERT(lock->isHeldByCurrentThread());
+	lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Channel::Channel
+//  Inicializamos el canal, vacío.
+//
+//  "debugName" nombre arbitrario del canal.
+//  "slots" cuántos mensajes puede guardar.
+//  "size" tamaño en bytes de cada mensaje.
+//----------------------------------------------------------------------
+
+Channel::Channel(const char* debugName, int slots, int size)
+{
+	ASSERT(slots > 0 && size > 0);
+	name = debugName;
+	capacity = slots;
+	messageSize = size;
+	buffer = new char[capacity * messageSize];
+	first = used = 0;
+	// El lock lleva el nombre del canal, para las estadísticas.
+	lock = new Lock(debugName);
+	notFull = new Condition("Channel Not Full", lock);
+	notEmpty = new Condition("Channel Not Empty", lock);
+}
+
+//----------------------------------------------------------------------
+// Channel::~Channel
+//  Liberamos el canal. Los mensajes que queden se pierden.
+//----------------------------------------------------------------------
+
+Channel::~Channel()
+{
+	delete notFull;
+	delete notEmpty;
+	delete lock;
+	delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// Channel::Send
+//  Mandamos "count" mensajes. Copiamos todos los que entran de una vez;
+//  si no entran todos, esperamos a que se libere lugar y seguimos.
+//  Despertamos a los receptores sólo cuando el canal estaba vacío, que
+//  es cuando puede haber alguno esperando.
+//
+//  "messages" los mensajes, uno detrás de otro.
+//  "count" cuántos son.
+//----------------------------------------------------------------------
+
+void Channel::Send(const void *messages, int count)
+{
+	const char *from = (const char *) messages;
+	
+	lock->Acquire();
+	while (count > 0)
+	{
+		while (used == capacity)
+			notFull->Wait();
+		
+		bool wasEmpty = (used == 0);
+		
+		// Copiamos los que entran, en a lo sumo dos tramos (el buffer
+		// es circular).
+		while (count > 0 && used < capacity)
+		{
+			int last = (first + used) % capacity;
+			int n = capacity - used;
+			
+			if (n > capacity - last)
+				n = capacity - last;
+			if (n > count)
+				n = count;
+			memcpy(buffer + last * messageSize, from, n * messageSize);
+			from += n * messageSize;
+			used += n;
+			count -= n;
+		}
+		if (wasEmpty)
+			notEmpty->Broadcast();
+	}
+	lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Channel::Receive
+//  Recibimos hasta "count" mensajes: si el canal está vacío esperamos
+//  a que llegue alguno, y después sacamos todos los que hay, sin
+//  pasarnos de "count". Si el canal estaba lleno despertamos a los
+//  emisores.
+//
+//  "messages" dónde copiar los mensajes recibidos.
+//  "count" cuántos caben ahí.
+//
+//  Devolvemos cuántos mensajes recibimos.
+//----------------------------------------------------------------------
+
+int Channel::Receive(void *messages, int count)
+{
+	char *to = (char *) messages;
+	int received = 0;
+	
+	ASSERT(count > 0);
+	lock->Acquire();
+	while (used == 0)
+		notEmpty->Wait();
+	
+	bool wasFull = (used == capacity);
+	
+	while (received < count && used > 0)
+	{
+		int n = capacity - first;
+		
+		if (n > used)
+			n = used;
+		if (n > count - received)
+			n = count - received;
+		memcpy(to, buffer + first * messageSize, n * messageSize);
+		to += n * messageSize;
+		first = (first + n) % capacity;
+		used -= n;
+		received += n;
+	}
+	if (wasFull)
+		notFull->Broadcast();
+	lock->Release();
+	return received;
+}
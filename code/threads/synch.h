@@ -25,6 +25,41 @@
 #include "thread.h"
 #include "list.h"
 
+class SyncStats;
+
+// Cola de hilos bloqueados en un semáforo o una variable condición, en
+// orden de llegada.  Los hilos se enlazan por Thread::queueNext: un hilo
+// espera en una sola cola a la vez, así que encolarlo no pide memoria.
+// Hay que llamar a estas operaciones con las interrupciones deshabilitadas.
+
+class WaitQueue {
+  public:
+    WaitQueue() { first = last = NULL; }
+
+    bool IsEmpty() { return first == NULL; }
+
+    void Append(Thread *thread) {	// agrega "thread" al final
+	thread->queueNext = NULL;
+	if (first == NULL)
+	    first = thread;
+	else
+	    last->queueNext = thread;
+	last = thread;
+    }
+
+    Thread *Remove() {			// saca el primero, o NULL si no hay
+	Thread *thread = first;
+	if (thread != NULL) {
+	    first = thread->queueNext;
+	    thread->queueNext = NULL;
+	}
+	return thread;
+    }
+
+  private:
+    Thread *first, *last;
+};
+
 // La siguiente clase define un "sem�foro" cuyo valor es un entero positivo.
 // El sem�foro ofrece s�lo dos operaciones, P() y V():
 //
@@ -52,8 +87,10 @@ class Semaphore {
   private:
     const char* name;        		// para depuraci�n
     int value;         		// valor del sem�foro, siempre es >= 0
-    List<Thread*> *queue;       // Cola con los hilos que esperan en P() porque el
+    WaitQueue queue;		// Cola con los hilos que esperan en P() porque el
                        		// valor es cero
+    SyncStats *syncStats;	// tiempo bloqueado en este semáforo
+				// (ver Statistics)
 };
 
 // La siguiente clase define un "cerrojo" (Lock). Un cerrojo puede tener
@@ -85,10 +122,22 @@ class Lock {
   // �til para comprobaciones en el Release() y en las variables condici�n
   bool isHeldByCurrentThread();	
 
+  // Mayor prioridad entre los hilos bloqueados en el cerrojo, o -1.
+  int MaxWaiterPriority();
+
+  // Siguiente cerrojo de la lista de cerrojos del dueño
+  // (Thread::heldLocks).
+  Lock *nextHeld;
+
   private:
     const char* name;				// para depuraci�n
     Semaphore* sem; // a�adir aqu� otros campos que sean necesarios
     Thread* owner;
+    // Hilos bloqueados en Acquire, enlazados por Thread::waitNext.
+    Thread* waiters;
+    int acquiredAt;		// cuándo lo tomó el dueño (para -lp)
+    SyncStats *syncStats;	// estadísticas de este lock (las del
+				// semáforo son aparte)
 };
 
 //  La siguiente clase define una "variable condici�n". Una variable condici�n
@@ -146,7 +195,9 @@ class Condition {
   // aqu� se a�aden otros campos que sean necesarios
     const char* name;
     Lock *lock;   // * Lock pasado en el arg
-    List<Semaphore*> *semList; // * Lista de threads durmiendo 
+    WaitQueue queue; // * Hilos durmiendo en Wait
+    SyncStats *syncStats;	// tiempo bloqueado en esta variable
+				// (ver Statistics)
 };
 
 /*
@@ -200,4 +251,97 @@ class Port {
 		Condition *receiverCondition;
 };
 
+// La siguiente clase define un cerrojo de lectores/escritores (RWLock).
+// Varios lectores pueden tenerlo a la vez (modo compartido), o un solo
+// escritor (modo exclusivo):
+//
+//	AcquireRead / ReleaseRead -- toman y sueltan el cerrojo para leer
+//
+//	AcquireWrite / ReleaseWrite -- toman y sueltan el cerrojo para
+//				       escribir
+//
+// Con preferencia por escritores, un escritor que espera a que salgan
+// los lectores no deja entrar a lectores nuevos (no se posterga a los
+// escritores); con preferencia por lectores, sólo los detiene un
+// escritor que ya tiene el cerrojo.
+//
+// La exclusión de los escritores es un Lock, así que el escritor hereda
+// la prioridad de quienes esperan por él igual que en Lock::Acquire
+// (también por la cadena de dueños). Un escritor que espera a que
+// salgan los lectores les presta su prioridad a ellos, y también a los
+// que entren mientras tanto; cada lector la devuelve al soltar el
+// cerrojo.
+
+enum RWPreference { PreferReaders, PreferWriters };
+
+class RWLock {
+  public:
+    RWLock(const char* debugName, RWPreference pref = PreferWriters);
+    ~RWLock();
+    const char* getName() { return name; }	// para depuración
+
+    void AcquireRead();
+    void ReleaseRead();
+    void AcquireWrite();
+    void ReleaseWrite();
+
+    // devuelve 'true' si el hilo actual tiene el cerrojo para escribir.
+    bool isWriteHeldByCurrentThread() { return lock->isHeldByCurrentThread(); }
+
+    // Prioridad que les prestan a los lectores los escritores que
+    // esperan que salgan, o -1.
+    int DrainPriority() { return drainPriority; }
+
+  private:
+    void Lend(Thread *thread, int priority);
+
+    const char* name;
+    RWPreference preference;
+    Lock *lock;			// lo tiene el escritor; los lectores lo
+				// toman sólo para entrar
+    int readers;		// lectores que tienen el cerrojo
+    Thread **readerThreads;	// quiénes son (para prestarles prioridad)
+    int maxReaders;		// lugar en readerThreads
+    WaitQueue drainQueue;	// escritores esperando que salgan los
+				// lectores
+    int drainPriority;		// la mayor prioridad entre ellos, o -1
+    SyncStats *syncStats;	// tiempo que esperan esos escritores
+};
+
+// La siguiente clase define un canal: como un puerto, pero con lugar
+// para "slots" mensajes de "size" bytes cada uno, así el
+// emisor no espera al receptor mientras el canal no esté lleno, y el
+// receptor no espera al emisor mientras no esté vacío:
+//
+//	Send -- agrega "count" mensajes al canal, esperando cuando está
+//		lleno; vuelve cuando los agregó todos
+//
+//	Receive -- saca hasta "count" mensajes, esperando sólo si está
+//		   vacío; devuelve cuántos sacó (al menos uno)
+//
+// Los mensajes salen en el orden en que entraron. Mandar o recibir
+// varios a la vez ahorra cambios de contexto en un pipeline de hilos.
+
+class Channel {
+  public:
+    Channel(const char* debugName, int slots, int size);
+    ~Channel();
+    const char* getName() { return name; }
+    int getMessageSize() { return messageSize; }
+
+    void Send(const void *messages, int count = 1);
+    int Receive(void *messages, int count = 1);
+
+  private:
+    const char* name;
+    int capacity;		// cuántos mensajes entran
+    int messageSize;		// bytes de cada mensaje
+    char *buffer;		// buffer circular de capacity mensajes
+    int first;			// posición del mensaje más viejo
+    int used;			// mensajes en el buffer
+    Lock *lock;
+    Condition *notFull;		// esperan los emisores
+    Condition *notEmpty;	// esperan los receptores
+};
+
 #endif // SYNCH_H
@@ -20,6 +20,7 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+Alarm *alarmClock;			// wakes up sleeping threads
 					
 // 2007, Jose Miguel Santos Espino
 PreemptiveScheduler* preemptiveScheduler = NULL;
@@ -33,11 +34,16 @@ FileSystem  *fileSystem;
 SynchDisk   *synchDisk;
 #endif
 
+Timer *timeSlicer;			// ends time slices, if there are any
+const char *statsFile;			// where to dump the statistics as
+					// JSON on halt, if anywhere
+Trace *trace;				// trace being recorded or replayed
+
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
 SynchConsole *synchConsole;
 BitMap *bitMap;
-Timer *timeSlicer;
+bool profileUser = false;	// count the instructions of user programs
 #endif
 
 #ifdef NETWORK
@@ -71,20 +77,27 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(void* dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if (interrupt->getStatus() != IdleMode) {
+	scheduler->QuantumExpired();
 	interrupt->YieldOnReturn();
+    }
 }
 
-void tsHandler (void*)
+//----------------------------------------------------------------------
+// TimeSliceHandler
+// 	Interrupt handler for the one-shot time slice timer.  The current
+//	thread used up its quantum; the scheduler only arms the timer when
+//	some other thread is ready to run (cf. Scheduler::ArmSlice).
+//----------------------------------------------------------------------
+static void
+TimeSliceHandler(void* dummy)
 {
-  static int contador_tics = 0;
-  contador_tics++;
-  if (contador_tics==10)
-  {
-    contador_tics=0;
-    interrupt->YieldOnReturn();
-  }
+    if (interrupt->getStatus() != IdleMode) {
+	scheduler->QuantumExpired();
+	interrupt->YieldOnReturn();
+    }
 }
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -101,6 +114,14 @@ Initialize(int argc, char **argv)
     int argCount;
     const char* debugArgs = "";
     bool randomYield = false;
+    int seed = 0;			// for the random time slices
+    const char *traceFile = NULL;	// record the events here?
+    const char *replayFile = NULL;	// or replay them from here?
+    bool hostProfile = false;		// sample the host's CPU time?
+    bool syncProfile = false;		// profile locks, semaphores and
+					// condition variables?
+    SchedulingPolicy policy = StaticPriorities;
+    int quantum = 0;			// 0: the policy's default
     
 
 // 2007, Jose Miguel Santos Espino
@@ -129,10 +150,35 @@ Initialize(int argc, char **argv)
 	    }
 	} else if (!strcmp(*argv, "-rs")) {
 	    ASSERT(argc > 1);
-	    RandomInit(atoi(*(argv + 1)));	// initialize pseudo-random
+	    seed = atoi(*(argv + 1));		// seed of the pseudo-random
 						// number generator
 	    randomYield = true;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-mlfq")) {
+	    policy = FeedbackQueues;		// multilevel feedback queues
+	} else if (!strcmp(*argv, "-stride")) {
+	    policy = StrideScheduling;		// proportional share
+	} else if (!strcmp(*argv, "-q")) {
+	    ASSERT(argc > 1);
+	    quantum = atoi(*(argv + 1));	// time slice, in ticks
+	    ASSERT(quantum > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-hp")) {
+	    hostProfile = true;			// profile the simulator itself
+	} else if (!strcmp(*argv, "-lp")) {
+	    syncProfile = true;			// find the contended locks
+	} else if (!strcmp(*argv, "-tr")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);		// record a trace of the run
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tp")) {
+	    ASSERT(argc > 1);
+	    replayFile = *(argv + 1);		// replay a trace
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-js")) {
+	    ASSERT(argc > 1);
+	    statsFile = *(argv + 1);		// dump statistics as JSON
+	    argCount = 2;
 	}
 	// 2007, Jose Miguel Santos Espino
 	else if (!strcmp(*argv, "-p")) {
@@ -147,11 +193,34 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = true;
+	else if (!strcmp(*argv, "-up"))
+	    profileUser = true;
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = true;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-dg")) {		// disk geometry
+	    ASSERT(argc > 2);
+	    SetDiskGeometry(atoi(*(argv + 1)), atoi(*(argv + 2)));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-dt")) {	// rotating disk timing
+	    ASSERT(argc > 2);
+	    SeekTime = atoi(*(argv + 1));
+	    RotationTime = atoi(*(argv + 2));
+	    ASSERT((SeekTime >= 0) && (RotationTime > 0));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-di")) {	// zero latency disk
+	    SetDiskModel(InstantDisk, 1);
+	} else if (!strcmp(*argv, "-ds")) {	// solid state disk
+	    ASSERT(argc > 2);
+	    SetDiskModel(SolidStateDisk, atoi(*(argv + 1)));
+	    FlashTime = atoi(*(argv + 2));
+	    ASSERT(FlashTime > 0);
+	    argCount = 3;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -167,11 +236,38 @@ Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    if (hostProfile)
+	stats->StartHostProfile();
+    stats->profileSync = syncProfile;
+    SyncStats::keepObjects = syncProfile;
+    trace = NULL;
+    if (replayFile != NULL) {			// same seed as the recording
+	trace = new Trace(replayFile, true, false, 0);
+	randomYield = trace->RandomYield();
+	seed = trace->Seed();
+    } else if (traceFile != NULL)
+	trace = new Trace(traceFile, false, randomYield, seed);
+    if (randomYield)
+	RandomInit(seed);			// initialize pseudo-random
+						// number generator
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
+    scheduler->SetPolicy(policy);
+    if (quantum > 0)
+	scheduler->SetQuantum(quantum);
     if (randomYield)				// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
+    // Time slicing is needed to run user programs, and by the policies
+    // that share the CPU over time; the kernel thread tests otherwise
+    // run without it, unless a quantum is given.
+    timeSlicer = NULL;
+#ifndef USER_PROGRAM
+    if ((policy != StaticPriorities) || (quantum > 0))
+#endif
+	timeSlicer = new Timer(TimeSliceHandler, 0);
+    alarmClock = new Alarm();
+
     threadToBeDestroyed = NULL;
 
     // We didn't explicitly allocate the current thread we are running in.
@@ -179,6 +275,7 @@ Initialize(int argc, char **argv)
     // object to save its state. 
     currentThread = new Thread("main",0,0);		
     currentThread->setStatus(RUNNING);
+    scheduler->StartCompeting(currentThread);
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
@@ -194,7 +291,6 @@ Initialize(int argc, char **argv)
     machine = new Machine(debugUserProg);	// this must come first
     synchConsole = new SynchConsole(NULL, NULL);
     bitMap =  new BitMap(NumPhysPages);
-    timeSlicer = new Timer (tsHandler, 0, false);
 
 #endif
 
@@ -241,8 +337,11 @@ Cleanup()
 #endif
     
     delete timer;
+    delete timeSlicer;
+    delete alarmClock;
     delete scheduler;
     delete interrupt;
+    delete trace;			// write out the rest of the trace
     
     Exit(0);
 }
@@ -15,6 +15,8 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "alarm.h"
+#include "trace.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -28,6 +30,12 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern Timer *timeSlicer;			// one-shot timer ending the
+						// current thread's time slice
+extern const char *statsFile;			// where to dump statistics
+extern Alarm *alarmClock;			// lets threads sleep for a while
+extern Trace *trace;				// events recorded or replayed,
+						// if any
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -39,7 +47,8 @@ extern SynchConsole* synchConsole;
 #include "bitmap.h"
 extern BitMap* bitMap;
 
-extern Timer *timeSlicer;
+#include "userprof.h"
+extern bool profileUser;	// profile user programs (-up)
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -19,16 +19,84 @@
 #include "switch.h"
 #include "synch.h"
 #include "system.h"
+#include <limits.h>
 
-// Lista de hilos presentes en el sistema. Agregamos hilos a lista en
+// Tabla de hilos presentes en el sistema. Agregamos hilos a la tabla en
 // Thread::Fork, porque es aquí donde se pone a los procesos en el
 // scheduler.
-List<Thread*> *procList = new List<Thread*>;
+ProcTable *procTable = new ProcTable();
 
 // this is put at the top of the execution stack,
 // for detecting stack overflows
 const unsigned STACK_FENCEPOST = 0xdeadbeef;	
 
+// Pilas de hilos que ya terminaron, para reusarlas en vez de pedir y
+// liberar memoria en cada Fork.  Cada pila libre guarda en su primera
+// palabra (la del STACK_FENCEPOST) un puntero a la siguiente; hay una
+// lista por cada tamaño de pila en uso.
+
+struct StackList {
+    int size;				// en palabras; 0 si no se usa
+    HostMemoryAddress *first;		// NULL si la lista está vacía
+};
+
+static StackList freeStacks[MaxPooledStacks];
+static int numFreeStacks = 0;
+
+//----------------------------------------------------------------------
+// GetStack
+//	Devolvemos una pila de "size" palabras, reusando una libre si hay.
+//	Las pilas nuevas tienen páginas de guarda a cada lado (ver
+//	AllocBoundedArray).
+//----------------------------------------------------------------------
+
+static HostMemoryAddress *
+GetStack(int size)
+{
+    for (int i = 0; i < MaxPooledStacks; i++)
+	if (freeStacks[i].size == size && freeStacks[i].first != NULL)
+	{
+	    HostMemoryAddress *stack = freeStacks[i].first;
+	    freeStacks[i].first = (HostMemoryAddress *) *stack;
+	    numFreeStacks--;
+	    return stack;
+	}
+    return (HostMemoryAddress *) AllocBoundedArray(size * sizeof(HostMemoryAddress));
+}
+
+//----------------------------------------------------------------------
+// PutStack
+//	Guardamos la pila de un hilo que terminó para reusarla, salvo que
+//	ya haya demasiadas guardadas.  Antes comprobamos que el hilo no se
+//	haya pasado de su pila, porque el STACK_FENCEPOST se va a pisar.
+//----------------------------------------------------------------------
+
+static void
+PutStack(HostMemoryAddress *stack, int size)
+{
+    ASSERT(*stack == STACK_FENCEPOST);
+    if (numFreeStacks < MaxPooledStacks)
+    {
+	// Buscamos la lista de ese tamaño; si no hay, usamos una vacía
+	// (siempre hay alguna, porque hay menos pilas que listas).
+	StackList *list = NULL;
+	for (int i = 0; i < MaxPooledStacks && list == NULL; i++)
+	    if (freeStacks[i].size == size)
+		list = &freeStacks[i];
+	for (int i = 0; i < MaxPooledStacks && list == NULL; i++)
+	    if (freeStacks[i].first == NULL)
+	    {
+		list = &freeStacks[i];
+		list->size = size;
+	    }
+	*stack = (HostMemoryAddress) list->first;
+	list->first = stack;
+	numFreeStacks++;
+	return;
+    }
+    DeallocBoundedArray((char *) stack, size * sizeof(HostMemoryAddress));
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -42,15 +110,32 @@ Thread::Thread(const char* threadName, int join = 0, int priority = 0)
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = StackSize;
     status = JUST_CREATED;
     toBeJoined = join;
     threadPriority = priority;
     initialPriority = priority;
     exitStatus = 0;
+    pid = -1;
+    readyNext = readyPrev = NULL;
+    heldLocks = blockedOn = NULL;
+    waitNext = NULL;
+    readLocks = NULL;
+    numReadLocks = maxReadLocks = 0;
+    queueNext = NULL;
+    cpuTicks = waitTicks = 0;
+    runningSince = readySince = 0;
+    tickets = DEFAULT_TICKETS;
+    pass = 0;
+    competing = false;
+    shareMark = requestedTicks = 0;
+    voluntarySwitches = involuntarySwitches = 0;
+    record = NULL;
     if (toBeJoined != 0)
 		port = new Port("Thread Port");
 #ifdef USER_PROGRAM
     space = NULL;
+    userStack = -1;
     for (int i = 0; i < FDTABLE_SIZE; i++)
     {
 		fdTable[i] = NULL;
@@ -76,7 +161,8 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(HostMemoryAddress));
+	PutStack(stack, stackSize);
+    delete [] readLocks;
 }
 
 //----------------------------------------------------------------------
@@ -94,12 +180,15 @@ Thread::~Thread()
 //		2. Initialize the stack so that a call to SWITCH will
 //		cause it to run the procedure
 //		3. Put the thread on the ready queue
+//
+//	Antes le damos un lugar en la tabla de procesos; si no hay, el
+//	hilo no se crea y devolvemos false.
 // 	
 //	"func" is the procedure to run concurrently.
 //	"arg" is a single argument to be passed to the procedure.
 //----------------------------------------------------------------------
 
-void 
+bool 
 Thread::Fork(VoidFunctionPtr func, void* arg)
 {
 #ifdef HOST_x86_64
@@ -111,14 +200,21 @@ Thread::Fork(VoidFunctionPtr func, void* arg)
 	  name, (HostMemoryAddress) func, arg);
 #endif
 
-    StackAllocate(func, arg);
-
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	// Agregamos a este hilo a la tabla de procesos.
+	pid = procTable->Add(this);
+	if (pid == -1)
+	{
+		DEBUG('t', "Too many threads, \"%s\" not forked\n", name);
+		interrupt->SetLevel(oldLevel);
+		return false;
+	}
+
+    StackAllocate(func, arg);
     scheduler->ReadyToRun(this);	// ReadyToRun assumes that interrupts 
 					// are disabled!
-	// Agregamos a este hilo a la lista procList.
-	procList->Append(this);
     interrupt->SetLevel(oldLevel);
+    return true;
 }    
 
 //----------------------------------------------------------------------
@@ -173,17 +269,10 @@ Thread::Finish ()
     if (toBeJoined != 0)
 		port->Send(exitStatus);
 	
-	// Removemos el hilo de la lista de procesos procList
-	Thread *first, *temp;
-	first = procList->Remove();
-	procList->Append(first);
+	// Removemos el hilo de la tabla de procesos.
+	procTable->Remove(pid);
 	
-	do
-	{
-		temp = procList->Remove();
-		if (this != temp)
-			procList->Append(temp);
-	} while (temp != first);
+	scheduler->PrintStats(this);
         
     threadToBeDestroyed = currentThread;
     Sleep();					// invokes SWITCH
@@ -222,13 +311,15 @@ Thread::Yield ()
     
     if (nextThread != NULL) {
 		// Si la prioridad del próximo hilo a poner en la CPU es menor
-		// a la del hilo actual, sigue ejecutando el hilo actual.
-		if (this->getPriority() <= nextThread->getPriority()) {
+		// a la del hilo actual (o, por pasos, si su pass es mayor),
+		// sigue ejecutando el hilo actual.
+		scheduler->Charge(this);
+		if (!scheduler->Precedes(this, nextThread)) {
 			scheduler->ReadyToRun(this);
 			scheduler->Run(nextThread);
 		}
 		else {
-			// Como la prioridad del próximo hilo es menor, no lo
+			// Como el próximo hilo tiene que esperar, no lo
 			// ponemos en la CPU y lo volvemos a colocar en el scheduler.
 			scheduler->ReadyToRun(nextThread);
 		}
@@ -267,6 +358,8 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
+    scheduler->Charge(this);
+    scheduler->StopCompeting(this);
     while ((nextThread = scheduler->FindNextToRun()) == NULL) {
 	interrupt->Idle();	// no one to run, wait for an interrupt
     }
@@ -300,10 +393,10 @@ static void InterruptEnable() { interrupt->Enable(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, void* arg)
 {
-    stack = (HostMemoryAddress *) AllocBoundedArray(StackSize * sizeof(HostMemoryAddress));
+    stack = GetStack(stackSize);
 
     // i386 & MIPS & SPARC stack works from high addresses to low addresses
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
 
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
@@ -381,51 +474,107 @@ Thread::removeFD(OpenFileId num)
 //----------------------------------------------------------------------
 // Thread::Join
 //	Nos bloqueamos hasta que child termine.
-//  Recorremos la procList, si child se encuentra en ella nos bloqueamos
-//  hasta que el child termine.
+//  Si child está en la tabla de procesos nos bloqueamos hasta que
+//  termine; si no (ya terminó, o el pid no es válido) devolvemos -1.
 //
-//  "child" hilo sobre el que hacemos el Join.
+//  "child" hilo (o pid del hilo) sobre el que hacemos el Join.
 //----------------------------------------------------------------------
 
 int
 Thread::Join(Thread* child)
 {
-	// Recorremos la lista de procesos procList para saber si el child
-	// es un hilo presente en el sistema.
-	Thread *first, *temp;
-	// Sacamos el primer hilo de la lista y lo ponemos al final, y
-	// conservamos el puntero para saber cuando parar de recorrer la
-	// lista de procesos.
-	first = procList->Remove();
-	procList->Append(first);
+	return Join(child->getPid());
+}
+
+int
+Thread::Join(int childPid)
+{
+	Thread *child = procTable->Lookup(childPid);
+	if (child == NULL || child->toBeJoined == 0)
+		return -1;
 	
-	do
+	int msg;
+	// Obtenemos el puerto del hijo.
+	Port *joinPort = child->getPort();
+	// Hacemos Receive sobre el puerto del hijo. Como la llamada
+	// es bloqueante, el hilo que llama al Join se bloquea y
+	// recién cuando se produzca el Send se desbloqueará. Esto
+	// ocurrirá solo cuando el child termine de ejecutarse, ya
+	// que la llamada a Send la colocamos en Thread::Finish.
+	joinPort->Receive(&msg);
+	// El padre libera el puerto del hijo. Si esto se hiciera en
+	// el destructor del hijo, corremos el riesgo que se borre
+	// el puerto antes que volvamos del Receive.
+	delete joinPort;
+	return msg;
+}
+
+//----------------------------------------------------------------------
+// ProcTable::ProcTable
+//	Al principio todos los lugares están libres.
+//----------------------------------------------------------------------
+
+ProcTable::ProcTable()
+{
+	for (int i = 0; i < MAX_PROCS; i++)
 	{
-		temp = procList->Remove();
-		if (child != temp)
-		{
-			procList->Append(temp);
-		}
-		else
-		{
-			// Encontramos el child en la lista.
-			procList->Append(temp);
-			int msg;
-			// Obtenemos el puerto del hijo.
-			Port *joinPort = child->getPort();
-			// Hacemos Receive sobre el puerto del hijo. Como la llamada
-			// es bloqueante, el hilo que llama al Join se bloquea y
-			// recién cuando se produzca el Send se desbloqueará. Esto
-			// ocurrirá solo cuando el child termine de ejecutarse, ya
-			// que la llamada a Send la colocamos en Thread::Finish.
-			joinPort->Receive(&msg);
-			// El padre libera el puerto del hijo. Si esto se hiciera en
-			// el destructor del hijo, corremos el riesgo que se borre
-			// el puerto antes que volvamos del Receive.
-			delete joinPort;
-			return msg;
-		}
-	} while (temp != first);
-	return -1;
+		threads[i] = NULL;
+		generation[i] = 0;
+		nextFree[i] = i + 1;
+	}
+	nextFree[MAX_PROCS - 1] = -1;
+	firstFree = 0;
 }
 
+//----------------------------------------------------------------------
+// ProcTable::Add
+//	Ponemos a "t" en el primer lugar libre y devolvemos su pid, o -1
+//	si no queda ninguno (los hilos que terminaron pero esperan su Join
+//	también ocupan lugar).
+//----------------------------------------------------------------------
+
+int
+ProcTable::Add(Thread *t)
+{
+	if (firstFree == -1)
+		return -1;
+	int slot = firstFree;
+	firstFree = nextFree[slot];
+	threads[slot] = t;
+	return generation[slot] * MAX_PROCS + slot;
+}
+
+//----------------------------------------------------------------------
+// ProcTable::Remove
+//	Liberamos el lugar del pid, e incrementamos su generación para que
+//	el pid deje de ser válido.
+//----------------------------------------------------------------------
+
+void
+ProcTable::Remove(int pid)
+{
+	if (Lookup(pid) == NULL)
+		return;
+	int slot = pid % MAX_PROCS;
+	threads[slot] = NULL;
+	// La generación vuelve a 0 antes de que el pid desborde un int.
+	generation[slot] = (generation[slot] + 1) % (INT_MAX / MAX_PROCS);
+	nextFree[slot] = firstFree;
+	firstFree = slot;
+}
+
+//----------------------------------------------------------------------
+// ProcTable::Lookup
+//	Devolvemos el hilo con ese pid, o NULL si no hay ninguno.
+//----------------------------------------------------------------------
+
+Thread *
+ProcTable::Lookup(int pid)
+{
+	if (pid < 0)
+		return NULL;
+	int slot = pid % MAX_PROCS;
+	if (threads[slot] == NULL || generation[slot] != pid / MAX_PROCS)
+		return NULL;
+	return threads[slot];
+}
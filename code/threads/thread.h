@@ -40,6 +40,9 @@
 #include "copyright.h"
 #include "utility.h"
 class Port; 
+class Lock;
+class RWLock;
+class ThreadStats;
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -57,7 +60,11 @@ const int MachineStateSize = 17;
 
 // Size of the thread's private execution stack.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
-const int StackSize = 4 * 1024;	// in words
+const int StackSize = 4 * 1024;	// in words, unless changed with
+				// Thread::setStackSize
+
+// Cantidad máxima de pilas libres que se guardan para reusar.
+const int MaxPooledStacks = 32;
 
 
 // Thread state
@@ -90,7 +97,9 @@ class Thread {
 
     // basic thread operations
 
-    void Fork(VoidFunctionPtr func, void* arg);	// Make thread run (*func)(arg)
+    bool Fork(VoidFunctionPtr func, void* arg);	// Make thread run (*func)(arg)
+						// (false if there are too
+						// many threads)
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
@@ -100,11 +109,60 @@ class Thread {
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
 	int Join(Thread* child);
+	int Join(int pid);			// Join por identificador (ver ProcTable)
+	int getPid() { return pid; }
+	
+	// Siguiente y anterior hilo en la cola de listos de su prioridad;
+	// los maneja el Scheduler, así encolar no necesita pedir memoria
+	// y un hilo se puede sacar de la cola sin recorrerla.
+	Thread *readyNext, *readyPrev;
+	
+	// Herencia de prioridades (ver Lock): locks que tiene el hilo,
+	// enlazados por Lock::nextHeld, el lock en el que está bloqueado
+	// (o NULL) y el siguiente hilo esperando ese mismo lock.
+	Lock *heldLocks;
+	Lock *blockedOn;
+	Thread *waitNext;
+	
+	// Cerrojos RWLock que el hilo tiene para leer (uno por cada
+	// AcquireRead), para no perder lo que nos prestan sus escritores
+	// al recalcular la prioridad (ver RWLock).
+	RWLock **readLocks;
+	int numReadLocks, maxReadLocks;
+	
+	// Siguiente hilo en la cola del semáforo o la variable condición
+	// en la que espera el hilo (ver WaitQueue en synch.h).
+	Thread *queueNext;
+	
+	// Tamaño de la pila (en palabras); solo se puede cambiar antes de Fork.
+	void setStackSize(int words) { ASSERT(stack == NULL); stackSize = words; }
 	
 	// Funciones para manejar prioridades.
 	int getPriority() { return threadPriority; }
 	void setPriority(int newPriority) { threadPriority = newPriority; }
 	int getInitialPriority() { return initialPriority; }
+	void setInitialPriority(int priority) { initialPriority = priority; }
+	
+	// Tiempos del hilo (en ticks), que lleva el Scheduler: cuánto usó
+	// la CPU, cuánto esperó en la cola de listos, y desde cuándo está
+	// corriendo o listo.
+	int cpuTicks, waitTicks;
+	int runningSince, readySince;
+	
+	// Planificación por pasos: tickets del hilo, su pass, y dónde
+	// anotamos la parte de la CPU que usó (-1 si todavía no).
+	int tickets;
+	long long pass;
+	
+	// Parte de la CPU que le corresponde por sus tickets mientras está
+	// listo o corriendo (ver Scheduler::StartCompeting).
+	bool competing;
+	double shareMark, requestedTicks;
+	
+	// Cambios de contexto del hilo, y dónde se guardan sus estadísticas
+	// (ver Scheduler::RecordStats; NULL si todavía no).
+	int voluntarySwitches, involuntarySwitches;
+	ThreadStats *record;
 	
 	void setExitStatus(int st) { exitStatus = st; }
 	
@@ -112,6 +170,7 @@ class Thread {
 	Port* getPort() { return port; }
 
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return status; }
     const char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
@@ -121,6 +180,7 @@ class Thread {
     HostMemoryAddress* stack; 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// Size of the stack, in words
     ThreadStatus status;		// ready, running or blocked
     const char* name;
     void StackAllocate(VoidFunctionPtr func, void* arg);
@@ -133,6 +193,8 @@ class Thread {
 	// Prioridades del hilo.
 	unsigned int threadPriority, initialPriority;
 	int exitStatus;
+	// Identificador del hilo en la tabla de procesos (-1 si no está).
+	int pid;
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -146,12 +208,42 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+    int userStack;			// Pila de usuario propia (hilos creados
+					// con la syscall Fork), -1 si no tiene
     OpenFile *getFD(OpenFileId num);
     OpenFileId createFD(OpenFile * op);
     void removeFD(OpenFileId num);
 #endif
 };
 
+// Tabla de procesos: asocia a cada hilo presente en el sistema un
+// identificador (pid), que es lo que ven los programas de usuario como
+// SpaceId.  El pid codifica el lugar del hilo en la tabla y un contador
+// de generación de ese lugar, que se incrementa cada vez que se libera;
+// así un pid viejo (de un hilo que ya terminó) no encuentra al hilo que
+// ocupe ese lugar después.  Los lugares libres forman una lista, por lo
+// que agregar, buscar y sacar un hilo son O(1).
+
+#define MAX_PROCS 128
+
+class ProcTable {
+  public:
+    ProcTable();
+
+    int Add(Thread *t);			// Devuelve el pid de "t", o -1
+					// si la tabla está llena
+    void Remove(int pid);
+    Thread *Lookup(int pid);		// NULL si el pid no es válido
+
+  private:
+    Thread *threads[MAX_PROCS];		// NULL si el lugar está libre
+    int generation[MAX_PROCS];
+    int nextFree[MAX_PROCS];		// Lista de lugares libres
+    int firstFree;			// -1 si la tabla está llena
+};
+
+extern ProcTable *procTable;
+
 // Magical machine-dependent routines, defined in switch.s
 
 extern "C" {
@@ -316,3 +316,265 @@ PriorityTest()
 	
 	low->Fork(lowPriority, (void*) lock); 
 }
+
+// Inversión de prioridades en cadena: "Chain Low" tiene lockA, "Chain
+// Mid" tiene lockB y espera lockA, y "Chain High" espera lockB. La
+// prioridad de High tiene que llegar hasta Low, así el hilo de
+// prioridad intermedia "Chain Busy" no lo posterga.
+
+Lock *lockA = new Lock("Chain Lock A");
+Lock *lockB = new Lock("Chain Lock B");
+int chainDone = 0, chainInverted = 0;
+
+void
+chainHigh(void* arg)
+{
+	lockB->Acquire();
+	printf(chainInverted ? "Failure!\n" : "Success!\n");
+	lockB->Release();
+}
+
+void
+chainBusy(void* arg)
+{
+	if (chainDone == 0)
+		chainInverted = 1;
+}
+
+void
+chainMid(void* arg)
+{
+	lockB->Acquire();
+	lockA->Acquire();
+	lockA->Release();
+	lockB->Release();
+}
+
+void
+chainLow(void* arg)
+{
+	lockA->Acquire();
+	(new Thread("Chain Mid", 0, 3))->Fork(chainMid, NULL);
+	currentThread->Yield();
+	
+	(new Thread("Chain High", 0, 9))->Fork(chainHigh, NULL);
+	(new Thread("Chain Busy", 0, 5))->Fork(chainBusy, NULL);
+	currentThread->Yield();
+	
+	chainDone++;
+	lockA->Release();
+}
+
+void
+ChainPriorityTest()
+{
+	(new Thread("Chain Low", 0, 0))->Fork(chainLow, NULL);
+}
+
+// Planificación por pasos (correr con -stride): tres hilos que usan la
+// CPU todo el tiempo, con 100, 200 y 300 tickets.  Al terminar, Halt
+// muestra la parte de la CPU que obtuvo cada uno.
+
+void
+strideWorker(void* arg)
+{
+	scheduler->SetTickets(currentThread, (long) arg);
+	while (stats->totalTicks < 100000)
+	{
+		// Cada vez que se habilitan las interrupciones avanza el reloj.
+		interrupt->SetLevel(IntOff);
+		interrupt->SetLevel(IntOn);
+	}
+}
+
+void
+StrideTest()
+{
+	(new Thread("Stride 100", 0, 0))->Fork(strideWorker, (void*) 100);
+	(new Thread("Stride 200", 0, 0))->Fork(strideWorker, (void*) 200);
+	(new Thread("Stride 300", 0, 0))->Fork(strideWorker, (void*) 300);
+}
+
+// Reloj despertador: cada hilo duerme un rato distinto con
+// Alarm::WaitUntil y se fija que se haya despertado a tiempo.  Se
+// despiertan en orden de duración, no de creación, y mientras duermen
+// la máquina queda ociosa (ver "idle" en las estadísticas).
+
+void
+alarmSleeper(void* arg)
+{
+	int ticks = (long) arg;
+	int start = stats->totalTicks;
+	
+	alarmClock->WaitUntil(ticks);
+	printf("%s: slept %d ticks, wanted %d: %s\n", currentThread->getName(),
+		stats->totalTicks - start, ticks,
+		stats->totalTicks - start >= ticks ? "Success!" : "Failure!");
+}
+
+void
+AlarmTest()
+{
+	(new Thread("Sleeper 3000", 0, 0))->Fork(alarmSleeper, (void*) 3000);
+	(new Thread("Sleeper 500", 0, 0))->Fork(alarmSleeper, (void*) 500);
+	(new Thread("Sleeper 1500", 0, 0))->Fork(alarmSleeper, (void*) 1500);
+}
+
+// Cerrojo de lectores/escritores: dos lectores leen a la vez; llega un
+// escritor, que espera a que salgan, y después otro lector, que con
+// preferencia por escritores tiene que entrar después del escritor.
+// Nunca puede haber un escritor junto con otro hilo adentro.
+
+RWLock *rwLock = new RWLock("RW Lock");
+int rwReaders = 0, rwMaxReaders = 0, rwWriters = 0;
+int rwWritten = 0, rwFailures = 0, rwDone = 0;
+
+void
+rwCheckDone()
+{
+	if (++rwDone == 4)
+		printf("RWLock: up to %d readers at once: %s\n", rwMaxReaders,
+			rwFailures == 0 ? "Success!" : "Failure!");
+}
+
+void
+rwReader(void* arg)
+{
+	rwLock->AcquireRead();
+	if (rwWriters > 0)
+		rwFailures++;
+	if (++rwReaders > rwMaxReaders)
+		rwMaxReaders = rwReaders;
+	currentThread->Yield();
+	currentThread->Yield();
+	// El lector que llegó después del escritor tiene que ver lo escrito.
+	if ((long) arg && !rwWritten)
+		rwFailures++;
+	rwReaders--;
+	rwLock->ReleaseRead();
+	rwCheckDone();
+}
+
+void
+rwWriter(void* arg)
+{
+	// El escritor crea a "Reader 3" con las interrupciones deshabilitadas,
+	// así no puede llegar antes que él aunque se corra con -rs.
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	(new Thread("Reader 3", 0, 0))->Fork(rwReader, (void*) 1);
+	rwLock->AcquireWrite();
+	(void) interrupt->SetLevel(oldLevel);
+	if (rwReaders > 0 || rwWriters > 0)
+		rwFailures++;
+	rwWriters++;
+	currentThread->Yield();
+	rwWritten = 1;
+	rwWriters--;
+	rwLock->ReleaseWrite();
+	rwCheckDone();
+}
+
+void
+RWLockTest()
+{
+	(new Thread("Reader 1", 0, 0))->Fork(rwReader, (void*) 0);
+	(new Thread("Reader 2", 0, 0))->Fork(rwReader, (void*) 0);
+	(new Thread("Writer", 0, 0))->Fork(rwWriter, NULL);
+}
+
+// Herencia de prioridad en el cerrojo de lectores/escritores: "RW Low"
+// (prioridad 0) lee; "RW High" (9) quiere escribir y espera a que salga,
+// prestándole su prioridad, así "RW Med" (5) no corre antes de que
+// "RW Low" suelte el cerrojo. Tomar y soltar otro lock mientras tanto
+// no le tiene que quitar el préstamo.
+
+RWLock *rwPriorityLock = new RWLock("RW Priority Lock");
+Lock *rwOtherLock = new Lock("RW Other Lock");
+int rwMedDone = 0;
+
+void
+rwHighWriter(void* arg)
+{
+	rwPriorityLock->AcquireWrite();
+	printf("RWLock priority: writer in\n");
+	rwPriorityLock->ReleaseWrite();
+}
+
+void
+rwMedWorker(void* arg)
+{
+	currentThread->Yield();
+	currentThread->Yield();
+	rwMedDone = 1;
+}
+
+void
+rwLowReader(void* arg)
+{
+	rwPriorityLock->AcquireRead();
+	(new Thread("RW High", 0, 9))->Fork(rwHighWriter, NULL);
+	(new Thread("RW Med", 0, 5))->Fork(rwMedWorker, NULL);
+	currentThread->Yield();
+	rwOtherLock->Acquire();
+	rwOtherLock->Release();
+	currentThread->Yield();
+	printf("RWLock priority: %s\n", rwMedDone == 0 ? "Success!" : "Failure!");
+	rwPriorityLock->ReleaseRead();
+}
+
+void
+RWPriorityTest()
+{
+	(new Thread("RW Low", 0, 0))->Fork(rwLowReader, NULL);
+}
+
+// Canal con lugar para 4 mensajes: el productor manda los números del
+// 1 al 20 de a tres, y el consumidor los saca de a cuatro como mucho.
+// Tienen que llegar todos, en orden, en bastantes menos recepciones
+// (y cambios de contexto) que con un Port.
+
+Channel *channel = new Channel("Test Channel", 4, sizeof(int));
+
+void
+channelProducer(void* arg)
+{
+	int batch[3];
+	
+	for (int i = 1; i <= 20; i += 3)
+	{
+		int n = 0;
+		
+		while (n < 3 && i + n <= 20)
+		{
+			batch[n] = i + n;
+			n++;
+		}
+		channel->Send(batch, n);
+	}
+}
+
+void
+channelConsumer(void* arg)
+{
+	int batch[4], expected = 1, receives = 0;
+	bool ok = true;
+	
+	while (expected <= 20)
+	{
+		int n = channel->Receive(batch, 4);
+		
+		receives++;
+		for (int i = 0; i < n; i++)
+			if (batch[i] != expected++)
+				ok = false;
+	}
+	printf("Channel: 20 messages in %d receives: %s\n", receives,
+		ok ? "Success!" : "Failure!");
+}
+
+void
+ChannelTest()
+{
+	(new Thread("Consumer", 0, 0))->Fork(channelConsumer, NULL);
+	(new Thread("Producer", 0, 0))->Fork(channelProducer, NULL);
+}
@@ -19,9 +19,14 @@
 #include "system.h"
 #include "addrspace.h"
 #include "noff.h"
+#include "synch.h"
 
 int getPage();
 
+static AddrSpace *spaces = NULL;	// every address space, for Evict
+static Lock *pagingLock = NULL;		// held while a mapped page is
+					// read in or evicted
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -57,9 +62,10 @@ SwapHeader (NoffHeader *noffH)
 //	only uniprogramming, and we have a single unsegmented page table
 //
 //	"executable" is the file containing the object code to load into memory
+//	"fileName" is its name, to identify its profile (with -up)
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executable, const char *fileName)
 {
     NoffHeader noffH;
     unsigned int i, size;
@@ -84,6 +90,18 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
+    programPages = numPages;
+    for (i = 0; i < MaxMappings; i++)
+	mappings[i].file = NULL;
+    nextVictim = 0;
+    nextSpace = spaces;
+    spaces = this;
+    if (pagingLock == NULL)
+	pagingLock = new Lock("paging");
+    freeStacks = new List<int>;
+    numThreads = 1;
+    profile = profileUser ? ProfileProgram(fileName, executable, &noffH)
+			  : NULL;
 // first, set up the translation 
     pageTable = new TranslationEntry[numPages];
     for (i = 0; i < numPages; i++) {
@@ -99,8 +117,11 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
    
 // zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    bzero(machine->mainMemory, size);
+// and the stack segment (only its own frames: other programs may be
+// using the rest of memory)
+    for (i = 0; i < numPages; i++)
+	bzero(&machine->mainMemory[pageTable[i].physicalPage * PageSize], 
+		PageSize);
 
 // then, copy in the code and data segments into memory
 		
@@ -133,11 +154,16 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+   AddrSpace **s = &spaces;
+
+   while (*s != this)
+	s = &(*s)->nextSpace;
+   *s = nextSpace;
    delete pageTable;
 }
 
@@ -191,13 +217,15 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	where to count the instructions of the program.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->profile = profile;
 }
 
 int getPage()
@@ -212,3 +240,354 @@ int AddrSpace::translate(int virtAddr)
 	int physPage = pageTable[virtPage].physicalPage;
 	return physPage * PageSize + virtAddr % PageSize;   
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::Map
+// 	Map the first "length" bytes of "file" into the address space,
+//	right after the last page in use.  The page table grows to cover
+//	the mapping, but its pages stay invalid until they are referenced
+//	(cf. HandlePageFault).  The file must stay open while it is mapped.
+//
+//	Like the other routines that change the mappings, this must be
+//	called by a thread running in this address space.
+//
+//	Return the virtual address of the mapping, or 0 if there are too
+//	many mappings already.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Map(OpenFile *file, int length)
+{
+    Mapping *m = NULL;
+    unsigned int i, pages;
+
+    if (length <= 0)
+	return 0;
+    for (i = 0; (i < MaxMappings) && (m == NULL); i++)
+	if (mappings[i].file == NULL)
+	    m = &mappings[i];
+    if (m == NULL)
+	return 0;
+
+    pages = divRoundUp(length, PageSize);
+    GrowPageTable(pages);		// loaded on the first reference
+    m->file = file;
+    m->firstPage = numPages - pages;
+    m->numPages = pages;
+    m->length = length;
+
+    DEBUG('a', "Mapped %d bytes at 0x%x\n", length, m->firstPage * PageSize);
+    return m->firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GrowPageTable
+// 	Add "pages" invalid pages at the end of the address space.  The
+//	page table is replaced by a bigger copy, so the machine has to be
+//	told where the new one is.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::GrowPageTable(int pages)
+{
+    TranslationEntry *newTable = new TranslationEntry[numPages + pages];
+    unsigned int i;
+
+    for (i = 0; i < numPages; i++)
+	newTable[i] = pageTable[i];
+    for (i = numPages; i < numPages + pages; i++) {
+	newTable[i].virtualPage = i;
+	newTable[i].physicalPage = -1;
+	newTable[i].valid = false;
+	newTable[i].use = false;
+	newTable[i].dirty = false;
+	newTable[i].readOnly = false;
+    }
+    delete [] pageTable;
+    pageTable = newTable;
+    numPages += pages;
+    RestoreState();			// the page table moved
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap, UnmapFile, UnmapAll
+// 	Remove the mapping that starts at "virtAddr", every mapping of
+//	"file", or every mapping, writing back the pages that were modified.
+//
+//	Unmap returns false if there is no mapping at "virtAddr".
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Unmap(int virtAddr)
+{
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i].file != NULL) 
+		&& (mappings[i].firstPage * PageSize == virtAddr)) {
+	    Release(&mappings[i]);
+	    return true;
+	}
+    return false;
+}
+
+void
+AddrSpace::UnmapFile(OpenFile *file)
+{
+    for (int i = 0; i < MaxMappings; i++)
+	if ((file != NULL) && (mappings[i].file == file))
+	    Release(&mappings[i]);
+}
+
+void
+AddrSpace::UnmapAll()
+{
+    for (int i = 0; i < MaxMappings; i++)
+	if (mappings[i].file != NULL)
+	    Release(&mappings[i]);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Release
+// 	Write back and free every page of mapping "m", and free the slot.
+//	If it was the last mapping in the address space, its virtual pages
+//	can be used again by the next one.
+//
+//	Done under "pagingLock", so that a fault on one of its pages waits
+//	until the mapping is gone instead of reading the file back in.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Release(Mapping *m)
+{
+    pagingLock->Acquire();
+    if (m->file != NULL) {		// not released while we waited
+	for (int i = 0; i < m->numPages; i++)
+	    WriteBack(m, m->firstPage + i);
+	if ((unsigned int) (m->firstPage + m->numPages) == numPages) {
+	    numPages = m->firstPage;
+	    RestoreState();
+	}
+	m->file = NULL;
+    }
+    pagingLock->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBack
+// 	If page "virtPage" of mapping "m" is in memory, write it back to 
+//	the file if it was modified, and free its physical page.  Only the
+//	bytes that are both mapped and inside the file are written.
+//
+//	The page is made invalid before the write, so it can't be changed
+//	while it is on its way to the file, but it keeps its physical page
+//	until the write is done.  The caller holds "pagingLock", so a
+//	fault on the page waits for the write to finish before reading
+//	the file again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBack(Mapping *m, int virtPage)
+{
+    TranslationEntry *entry = &pageTable[virtPage];
+    int frame = entry->physicalPage;
+    int offset = (virtPage - m->firstPage) * PageSize;
+    int end = m->length;
+    int bytes;
+
+    if (m->file->Length() < end)
+	end = m->file->Length();
+    bytes = end - offset;
+    if (bytes > PageSize)
+	bytes = PageSize;
+
+    ASSERT(pagingLock->isHeldByCurrentThread());
+    if (!entry->valid)
+	return;
+    entry->valid = false;
+    if (entry->dirty && (bytes > 0)) {
+	DEBUG('a', "Writing back page %d, %d bytes\n", virtPage, bytes);
+	m->file->WriteAt(&machine->mainMemory[frame * PageSize], bytes, offset);
+    }
+    bitMap->Clear(frame);		// "entry" may be stale by now
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+// 	Return the mapping that contains virtual page "virtPage", or NULL.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::FindMapping(int virtPage)
+{
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i].file != NULL) && (virtPage >= mappings[i].firstPage)
+		&& (virtPage < mappings[i].firstPage + mappings[i].numPages))
+	    return &mappings[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Evict
+// 	Physical memory is full: free the frame of one of the mapped pages,
+//	writing it back if it was modified.  A page of this address space
+//	is preferred; if it has none in memory, one of another space is
+//	taken (it will fault it back in when it needs it), so that a
+//	program with few mapped pages is not stuck when the others fill
+//	the memory.
+//
+//	Return false if no mapped page is in memory, in any space.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Evict()
+{
+    if (EvictMapped())
+	return true;
+    for (AddrSpace *s = spaces; s != NULL; s = s->nextSpace)
+	if ((s != this) && s->EvictMapped())
+	    return true;
+    return false;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictMapped
+// 	Free the frame of one of the mapped pages of this address space,
+//	visiting them in round-robin order.  Return false if none of them
+//	is in memory.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::EvictMapped()
+{
+    int numMapped = numPages - programPages;
+    int virtPage;
+    Mapping *m;
+
+    for (int i = 0; i < numMapped; i++) {
+	virtPage = programPages + (nextVictim++ % numMapped);
+	m = FindMapping(virtPage);
+	if ((m != NULL) && pageTable[virtPage].valid) {
+	    WriteBack(m, virtPage);
+	    return true;
+	}
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Called on a page fault at "virtAddr".  If it falls in a mapped
+//	file, read the page from the file into a free physical page 
+//	(evicting another mapped page if there is none), and make it valid,
+//	so the faulting instruction can be restarted.
+//
+//	Loading a page blocks on the disk, so faults are handled one at
+//	a time under "pagingLock"; another thread of this space may have
+//	loaded the page (or unmapped it) while we waited, so check
+//	again once we hold it, and after evicting.
+//
+//	Return false if the fault can't be fixed.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandlePageFault(int virtAddr)
+{
+    int virtPage = virtAddr / PageSize;
+    Mapping *m = FindMapping(virtPage);
+    char *page;
+    int frame;
+
+    if ((virtAddr < 0) || (m == NULL) || pageTable[virtPage].valid)
+	return false;
+
+    pagingLock->Acquire();
+    for (;;) {
+	m = FindMapping(virtPage);
+	if ((m == NULL) || pageTable[virtPage].valid) {
+	    pagingLock->Release();		// changed while we waited
+	    return (m != NULL);
+	}
+	if (bitMap->NumClear() > 0)
+	    break;
+	if (!Evict()) {
+	    pagingLock->Release();
+	    return false;
+	}
+    }
+
+    DEBUG('a', "Loading mapped page %d\n", virtPage);
+    stats->numPageFaults++;
+    frame = bitMap->Find();
+    page = &machine->mainMemory[frame * PageSize];
+    bzero(page, PageSize);
+    m->file->ReadAt(page, PageSize, (virtPage - m->firstPage) * PageSize);
+    pageTable[virtPage].physicalPage = frame;
+    pageTable[virtPage].use = false;
+    pageTable[virtPage].dirty = false;
+    pageTable[virtPage].valid = true;
+    pagingLock->Release();
+    return true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+// 	Give a thread created with Fork a user stack of its own.  The stack
+//	of a thread that already finished is used again if there is one;
+//	otherwise new pages are added at the end of the address space.
+//
+//	Return the initial value for the thread's stack pointer, or -1
+//	if there is not enough free memory for a new stack.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack()
+{
+    int firstPage;
+
+    if (!freeStacks->IsEmpty())
+	return freeStacks->Remove();
+
+    if (bitMap->NumClear() < UserStackPages) {
+	DEBUG('a', "No memory for a new user stack\n");
+	return -1;
+    }
+    firstPage = numPages;
+    GrowPageTable(UserStackPages);
+    for (unsigned int i = firstPage; i < numPages; i++) {
+	pageTable[i].physicalPage = getPage();
+	pageTable[i].valid = true;
+	bzero(&machine->mainMemory[pageTable[i].physicalPage * PageSize], 
+		PageSize);
+    }
+    DEBUG('a', "New user stack at pages %d-%d\n", firstPage, numPages - 1);
+    return numPages * PageSize - 16;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeStack
+// 	The thread that was using the stack at "stackTop" is done; keep
+//	the stack for the next thread.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreeStack(int stackTop)
+{
+    freeStacks->Append(stackTop);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitThreadRegisters
+// 	Set the initial values for the user-level registers of a thread
+//	created with Fork: it starts at "func", on the stack at "stackTop".
+//	If "func" returns, it returns to UserThreadReturn (cf. addrspace.h).
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitThreadRegisters(int func, int stackTop)
+{
+    for (int i = 0; i < NumTotalRegs; i++)
+	machine->WriteRegister(i, 0);
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(StackReg, stackTop);
+    machine->WriteRegister(RetAddrReg, UserThreadReturn);
+}
@@ -15,29 +15,90 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "list.h"
+#include "userprof.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxMappings		8	// files mapped at once, per space
+#define UserStackPages		divRoundUp(UserStackSize, PageSize)
+
+// Return address given to threads created with Fork; returning from
+// the thread's procedure jumps here, outside any address space, and the
+// kernel takes the resulting address error as a call to Exit(0).
+#define UserThreadReturn	0x7ffffff0
+
+// A file mapped into the address space by Mmap.  Its pages follow the
+// stack, and are loaded from the file on the first reference.
+
+class Mapping {
+  public:
+    OpenFile *file;			// NULL if the slot is free
+    int firstPage;			// first virtual page of the mapping
+    int numPages;			// number of pages it covers
+    int length;				// bytes mapped
+};
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(OpenFile *executable, const char *fileName);
+					// Create an address space,
 					// initializing it with the program
 					// stored in the file "executable"
+					// (named "fileName")
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
+    void InitThreadRegisters(int func, int stackTop);
+					// Same, for a thread created with Fork
+					// to run "func" on its own stack
+
+    int AllocateStack();		// Add a user stack for a new thread;
+					// return its initial stack pointer
+    void FreeStack(int stackTop);	// The thread using it is done
+    void AddThread() { numThreads++; }	// One more/less thread running in
+    int RemoveThread() { return --numThreads; } // this space
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
     
     int translate(int virtAddr);
 
+    int Map(OpenFile *file, int length);// Map "file" after the stack;
+					// return its address, or 0
+    bool Unmap(int virtAddr);		// Unmap the file mapped at virtAddr
+    void UnmapFile(OpenFile *file);	// Unmap every mapping of "file"
+    void UnmapAll();			// Unmap everything (on Exit)
+    bool HandlePageFault(int virtAddr); // Load a page of a mapped file;
+					// false if virtAddr isn't mapped
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    unsigned int programPages;		// Pages of code, data and stack;
+					// the mappings come after these
+    Mapping mappings[MaxMappings];
+    int nextVictim;			// Where to look for a mapped page
+					// to evict, when memory is full
+    List<int> *freeStacks;		// Stacks of threads that are done,
+					// ready for the next Fork
+    int numThreads;			// Threads running in this space
+    UserProfile *profile;		// Where its instructions are
+					// counted, if they are
+
+    void GrowPageTable(int pages);	// Add invalid pages at the end
+    Mapping *FindMapping(int virtPage);	// Mapping containing virtPage
+    void Release(Mapping *m);		// Write back and free its pages
+    void WriteBack(Mapping *m, int virtPage);
+					// Write back virtPage if dirty, and
+					// free its frame
+    bool Evict();			// Free the frame of some mapped page,
+					// of this space or another one
+    bool EvictMapped();			// Same, only in this space
+    AddrSpace *nextSpace;		// Next space, in the list of all of
+					// them (where to look for victims)
 };
 
 #endif // ADDRSPACE_H
@@ -26,6 +26,7 @@
 #include "syscall.h"
 #include "openfile.h"
 #include "synchconsole.h"
+#include "synch.h"
 
 bool ReadString(int addr, char *buffer);
 bool WriteString(int addr, char *buffer);
@@ -33,6 +34,25 @@ bool ReadBuffer(int addr, char *buffer, int size);
 bool WriteBuffer(int addr, char *buffer, int size);
 void UpdateProgramCounter();
 void newThreadExec(void* arg);
+void newUserThread(void* arg);
+void ExitThread(int status);
+int ChannelSendUser(Channel *channel, int addr, int count);
+int ChannelReceiveUser(Channel *channel, int addr, int count);
+
+// Nombres de las system calls, por número, para el perfil del host (-hp).
+static const char *syscallNames[] = { "Halt", "Exit", "Exec", "Join",
+	"Create", "Open", "Read", "Write", "Close", "Fork", "Yield", "Mmap",
+	"Munmap", "SetTickets", "ChannelCreate", "ChannelSend",
+	"ChannelReceive" };
+
+// Canales creados con ChannelCreate, por identificador. Duran hasta que
+// Nachos termina.
+#define MAX_CHANNELS 16
+// Tamaño máximo de un canal (capacity * size), y de lo que copiamos de
+// una vez entre el usuario y el kernel.
+#define MAX_CHANNEL_BYTES 4096
+static Channel *channels[MAX_CHANNELS];
+static int numChannels = 0;
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -71,6 +91,10 @@ ExceptionHandler(ExceptionType which)
 	OpenFile *op;
 	
     if ((which == SyscallException)) {
+		if (0 <= type && type <= SC_ChannelReceive)
+			stats->hostLabel = syscallNames[type];
+		if (trace != NULL)
+			trace->Record(TraceSyscall, type, arg1);
 		switch (type) {
 			    case SC_Halt:
 						DEBUG('a', "Shutdown, initiated by user program.\n");
@@ -78,9 +102,7 @@ ExceptionHandler(ExceptionType which)
 						break;
 				// void Exit(int status);
 				case SC_Exit:
-						DEBUG('a', "Thread \"%s\" exited with status %d", currentThread->getName(), arg1);
-						currentThread->setExitStatus(arg1);
-						currentThread->Finish();
+						ExitThread(arg1);
 						break;
 				// SpaceId Exec(char *name);
 				case SC_Exec:
@@ -101,20 +123,28 @@ ExceptionHandler(ExceptionType which)
 						}
 						
 						AddrSpace *space;
-						space = new AddrSpace(executable);
+						space = new AddrSpace(executable, buffer);
 						
 						Thread *thread;
 						thread = new Thread(buffer, 1, 0);
 						thread->space = space;
-						thread->Fork(newThreadExec, (void*) 0);
+						if (!thread->Fork(newThreadExec, (void*) 0))
+						{
+							DEBUG('a', "Too many threads to Exec \"%s\"\n", buffer);
+							delete thread->getPort();
+							delete thread;
+							delete space;
+							machine->WriteRegister(2, -1);
+							break;
+						}
 						
-						machine->WriteRegister(2, (SpaceId) thread);
+						machine->WriteRegister(2, thread->getPid());
 						break;
 						
 				// int Join(SpaceId id);
 				case SC_Join:
 						int st;
-						st = currentThread->Join((Thread*) arg1);
+						st = currentThread->Join(arg1);
 						machine->WriteRegister(2, st);
 						break;
 				
@@ -234,13 +264,148 @@ ExceptionHandler(ExceptionType which)
 						
 				// void Close(OpenFileId id);
 				case SC_Close:
+						// Si el archivo estaba mapeado, primero lo desmapeamos.
+						currentThread->space->UnmapFile(currentThread->getFD(arg1));
 						currentThread->removeFD(arg1);
 						DEBUG('a', "Closed the file with file descriptor \"%d\".\n",  arg1);
 						break;
+				
+				// char *Mmap(OpenFileId id, int length);
+				case SC_Mmap:
+						op = currentThread->getFD(arg1);
+						if (op == NULL)
+						{
+							DEBUG('a', "There is no file descriptor with number \"%d\"\n", arg1);
+							machine->WriteRegister(2, 0);
+							break;
+						}
+						
+						int addr;
+						addr = currentThread->space->Map(op, arg2);
+						DEBUG('a', "Mapped the file with file descriptor \"%d\" at 0x%x.\n", arg1, addr);
+						machine->WriteRegister(2, addr);
+						break;
+				
+				// void Munmap(char *addr);
+				case SC_Munmap:
+						if (!currentThread->space->Unmap(arg1))
+							DEBUG('a', "There is no file mapped at 0x%x\n", arg1);
+						break;
+						
+				// void Fork(void (*func)());
+				case SC_Fork:
+						int stackTop;
+						stackTop = currentThread->space->AllocateStack();
+						if (stackTop == -1)
+						{
+							DEBUG('a', "No memory for the stack of a new user thread\n");
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						Thread *child;
+						child = new Thread(currentThread->getName(), 0, currentThread->getPriority());
+						child->tickets = currentThread->tickets;
+						child->space = currentThread->space;
+						child->userStack = stackTop;
+						child->space->AddThread();
+						if (!child->Fork(newUserThread, (void*) (long) arg1))
+						{
+							DEBUG('a', "Too many threads to Fork a user thread\n");
+							child->space->RemoveThread();
+							child->space->FreeStack(stackTop);
+							delete child;
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						DEBUG('a', "Forked a user thread at 0x%x, stack 0x%x\n", arg1, child->userStack);
+						machine->WriteRegister(2, 0);
+						break;
+				
+				// void Yield();
+				case SC_Yield:
+						currentThread->Yield();
+						break;
+				
+				// int SetTickets(int tickets);
+				case SC_SetTickets:
+						if (arg1 < 1 || arg1 > MAX_TICKETS)
+						{
+							DEBUG('a', "Invalid number of tickets \"%d\"\n", arg1);
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						machine->WriteRegister(2, currentThread->tickets);
+						scheduler->SetTickets(currentThread, arg1);
+						DEBUG('a', "\"%s\" now has %d tickets\n", currentThread->getName(), arg1);
+						break;
+				
+				// ChannelId ChannelCreate(int capacity, int size);
+				case SC_ChannelCreate:
+						if (numChannels == MAX_CHANNELS || arg1 <= 0 || arg2 <= 0 ||
+							arg1 > MAX_CHANNEL_BYTES / arg2)
+						{
+							DEBUG('a', "Could not create a channel for %d messages of %d bytes\n", arg1, arg2);
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						// El nombre lleva el identificador, para distinguir
+						// a los canales en las estadísticas.
+						char *channelName;
+						channelName = new char[24];
+						sprintf(channelName, "Channel %d", numChannels);
+						channels[numChannels] = new Channel(channelName, arg1, arg2);
+						DEBUG('a', "Created channel %d, for %d messages of %d bytes\n", numChannels, arg1, arg2);
+						machine->WriteRegister(2, numChannels++);
+						break;
+				
+				// int ChannelSend(ChannelId id, char *buffer, int count);
+				case SC_ChannelSend:
+						if (arg1 < 0 || arg1 >= numChannels || arg3 < 0)
+						{
+							DEBUG('a', "Invalid channel \"%d\" or count \"%d\"\n", arg1, arg3);
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						if (ChannelSendUser(channels[arg1], arg2, arg3) < 0)
+						{
+							DEBUG('a', "Could not read the buffer in syscall ChannelSend\n");
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						machine->WriteRegister(2, 0);
+						break;
+				
+				// int ChannelReceive(ChannelId id, char *buffer, int count);
+				case SC_ChannelReceive:
+						if (arg1 < 0 || arg1 >= numChannels || arg3 <= 0)
+						{
+							DEBUG('a', "Invalid channel \"%d\" or count \"%d\"\n", arg1, arg3);
+							machine->WriteRegister(2, -1);
+							break;
+						}
+						machine->WriteRegister(2, ChannelReceiveUser(channels[arg1], arg2, arg3));
+						break;
 						
 				default: break;
 		}
 		UpdateProgramCounter();
+    } else if ((which == PageFaultException) &&
+    		currentThread->space->HandlePageFault(machine->ReadRegister(BadVAddrReg))) {
+		// Página de un archivo mapeado: ya está cargada, así que
+		// la instrucción se vuelve a ejecutar (no avanzamos el PC).
+		DEBUG('a', "Page fault at 0x%x handled\n", machine->ReadRegister(BadVAddrReg));
+    } else if (which == PageFaultException) {
+		// La página no se pudo cargar: no queda memoria libre ni
+		// páginas mapeadas para desalojar, o la dirección no está
+		// mapeada. Terminamos sólo este hilo, no todo Nachos.
+		printf("Page fault at 0x%x could not be handled, \"%s\" exits\n",
+			machine->ReadRegister(BadVAddrReg), currentThread->getName());
+		ExitThread(-1);
+    } else if ((which == AddressErrorException) && 
+    		(machine->ReadRegister(BadVAddrReg) == UserThreadReturn)) {
+		// Un hilo creado con Fork volvió de su función (ver
+		// AddrSpace::InitThreadRegisters): es como si llamara a Exit(0).
+		ExitThread(0);
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(false);
@@ -251,12 +416,40 @@ ExceptionHandler(ExceptionType which)
 
 // Hacer funciones para leer string, leer buffer, y escribir ambas
 
+// Antes de leer o escribir memoria del usuario desde el kernel,
+// traducimos la dirección nosotros: si cae en una página todavía no
+// cargada de un archivo mapeado, la cargamos. Así ReadMem/WriteMem no
+// provocan excepciones, que el manejador trataría como un error del
+// programa; una dirección inválida sólo hace fallar la system call.
+static bool UserAccessible(int addr, int size, bool writing)
+{
+	int physAddr;
+	ExceptionType exception = machine->Translate(addr, &physAddr, size, writing);
+	
+	if (exception == PageFaultException &&
+		currentThread->space->HandlePageFault(addr))
+		exception = machine->Translate(addr, &physAddr, size, writing);
+	return exception == NoException;
+}
+
+static bool UserReadMem(int addr, int size, int *value)
+{
+	return UserAccessible(addr, size, false) &&
+		machine->ReadMem(addr, size, value);
+}
+
+static bool UserWriteMem(int addr, int size, int value)
+{
+	return UserAccessible(addr, size, true) &&
+		machine->WriteMem(addr, size, value);
+}
+
 bool ReadString(int addr, char *buffer)
 {
 	int i = 0;
 	do
 	{
-		if (!machine->ReadMem(addr + i, 1, (int*) &buffer[i]))
+		if (!UserReadMem(addr + i, 1, (int*) &buffer[i]))
 			return false;
 	} while (buffer[i++] != '\0');
 	return true;
@@ -267,7 +460,7 @@ bool WriteString(int addr, char *buffer)
 	int i = 0;
 	do
 	{
-		if (!machine->WriteMem(addr + i, 1, (int) buffer[i]))
+		if (!UserWriteMem(addr + i, 1, (int) buffer[i]))
 			return false;
 	} while (buffer[i++] != '\0');
 	return true;
@@ -278,7 +471,7 @@ bool ReadBuffer(int addr, char *buffer, int size)
 	int i = 0;
 	while (i < size)
 	{
-		if (!machine->ReadMem(addr + i, 1, (int*) &buffer[i]))
+		if (!UserReadMem(addr + i, 1, (int*) &buffer[i]))
 			return false;
 		i++;
 	}
@@ -290,13 +483,87 @@ bool WriteBuffer(int addr, char *buffer, int size)
 	int i = 0;
 	while (i < size)
 	{
-		if (!machine->WriteMem(addr + i, 1, (int) buffer[i]))
+		if (!UserWriteMem(addr + i, 1, (int) buffer[i]))
 			return false;
 		i++;
 	}
 	return true;
 }
 
+// Comprobamos que se pueden leer (o escribir) "count" mensajes de
+// "size" bytes a partir de "addr": basta con traducir un byte de cada
+// página.
+static bool CheckAccessible(int addr, int count, int size, bool writing)
+{
+	if (addr < 0 || count < 0 || count > (0x7fffffff - addr) / size)
+		return false;			// no entra en el espacio
+	int end = addr + count * size;
+	
+	for (int a = addr; a < end; a = (a / PageSize + 1) * PageSize)
+		if (!UserAccessible(a, 1, writing))
+			return false;
+	return true;
+}
+
+// Mandamos "count" mensajes que están en "addr" por el canal, de a
+// tandas de MAX_CHANNEL_BYTES como mucho. Devolvemos -1 si no podemos
+// leer el buffer del usuario. Lo comprobamos entero antes de mandar la
+// primera tanda, así no queda un envío a medias.
+int ChannelSendUser(Channel *channel, int addr, int count)
+{
+	int size = channel->getMessageSize();
+	int batch = MAX_CHANNEL_BYTES / size;
+	char *messages;
+	
+	if (!CheckAccessible(addr, count, size, false))
+		return -1;
+	messages = new char[batch * size];
+	while (count > 0)
+	{
+		int n = count < batch ? count : batch;
+		
+		if (!ReadBuffer(addr, messages, n * size))
+		{
+			delete [] messages;
+			return -1;
+		}
+		channel->Send(messages, n);
+		addr += n * size;
+		count -= n;
+	}
+	delete [] messages;
+	return 0;
+}
+
+// Recibimos hasta "count" mensajes del canal en "addr" (a lo sumo
+// MAX_CHANNEL_BYTES). Devolvemos cuántos, o -1 si no podemos escribir
+// el buffer del usuario. Lo comprobamos antes de sacar los mensajes del
+// canal, así no se pierden.
+int ChannelReceiveUser(Channel *channel, int addr, int count)
+{
+	int size = channel->getMessageSize();
+	int batch = MAX_CHANNEL_BYTES / size;
+	char *messages;
+	int received;
+	
+	if (count > batch)
+		count = batch;
+	if (!CheckAccessible(addr, count, size, true))
+	{
+		DEBUG('a', "Could not write the buffer in syscall ChannelReceive\n");
+		return -1;
+	}
+	messages = new char[count * size];
+	received = channel->Receive(messages, count);
+	if (!WriteBuffer(addr, messages, received * size))
+	{
+		DEBUG('a', "Could not write the buffer in syscall ChannelReceive\n");
+		received = -1;
+	}
+	delete [] messages;
+	return received;
+}
+
 void UpdateProgramCounter()
 {
 	int pc;
@@ -308,6 +575,30 @@ void UpdateProgramCounter()
 	machine->WriteRegister(NextPCReg, pc);
 }
 
+// Termina el hilo actual con estado "status".  Si era el último hilo
+// del espacio de direcciones, escribimos a disco las páginas modificadas
+// de los archivos mapeados.
+void ExitThread(int status)
+{
+	DEBUG('a', "Thread \"%s\" exited with status %d\n", currentThread->getName(), status);
+	currentThread->setExitStatus(status);
+	AddrSpace *space = currentThread->space;
+	if (currentThread->userStack != -1)
+		space->FreeStack(currentThread->userStack);
+	if (space->RemoveThread() == 0)
+		space->UnmapAll();
+	currentThread->Finish();
+}
+
+// Punto de entrada de los hilos creados con la syscall Fork: comparten
+// el espacio de direcciones, pero corren en su propia pila de usuario.
+void newUserThread(void* arg)
+{
+	currentThread->space->InitThreadRegisters((long) arg, currentThread->userStack);
+	currentThread->space->RestoreState();
+	machine->Run();
+}
+
 void newThreadExec(void* arg)
 {
 	currentThread->space->InitRegisters();
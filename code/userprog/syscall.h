@@ -29,6 +29,12 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_Mmap		11
+#define SC_Munmap	12
+#define SC_SetTickets	13
+#define SC_ChannelCreate	14
+#define SC_ChannelSend	15
+#define SC_ChannelReceive	16
 
 #ifndef IN_ASM
 
@@ -54,7 +60,8 @@ void Exit(int status);
 typedef int SpaceId;	
  
 /* Run the executable, stored in the Nachos file "name", and return the 
- * address space identifier
+ * address space identifier, or -1 if it cannot be run (there is no such
+ * file, or there are too many threads)
  */
 SpaceId Exec(char *name);
  
@@ -104,9 +111,25 @@ void Write(char *buffer, int size, OpenFileId id);
  */
 int Read(char *buffer, int size, OpenFileId id);
 
-/* Close the file, we're done reading and writing to it. */
+/* Close the file, we're done reading and writing to it.  Any mapping
+ * of the file (see Mmap) is removed first.
+ */
 void Close(OpenFileId id);
 
+/* Map the first "length" bytes of the open file into the address space,
+ * and return the address where they start, or 0 on error.  Pages are 
+ * read from the file the first time they are touched; modified pages 
+ * are written back when the file is unmapped, when the program exits,
+ * or when their memory is needed for other mapped pages.  Bytes past the
+ * end of the file read as zero, and are not written back.
+ */
+char *Mmap(OpenFileId id, int length);
+
+/* Unmap the file mapped at "addr" (as returned by Mmap), writing 
+ * back any modified pages.
+ */
+void Munmap(char *addr);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -114,15 +137,51 @@ void Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread.  The new thread gets its own stack, and starts
+ * with no open files.  Returning from "func" is the same as Exit(0).
+ * Return 0, or -1 if there is no memory for the new thread's stack, or
+ * there are too many threads.
  */
-void Fork(void (*func)());
+int Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 
  */
 void Yield();		
 
+/* Set the number of tickets of the calling thread (between 1 and 10000).
+ * When Nachos runs with -stride, each thread gets a share of the CPU
+ * proportional to its tickets.  Return the previous number of tickets,
+ * or -1 if "tickets" is out of range.
+ */
+int SetTickets(int tickets);
+
+/* Channels: bounded queues of fixed-size messages, shared by every
+ * thread and every program.  A sender only waits when the channel is
+ * full, and a receiver only when it is empty.
+ */
+
+/* A unique identifier for a channel. */
+typedef int ChannelId;
+
+/* Create a channel with room for "capacity" messages of "size" bytes 
+ * each, and return its identifier, or -1 on error.  Channels last until
+ * Nachos halts.
+ */
+ChannelId ChannelCreate(int capacity, int size);
+
+/* Send the "count" messages stored one after the other in "buffer", 
+ * waiting while the channel is full.  Return 0, or -1 on error (if
+ * "buffer" cannot be read, no messages are sent).
+ */
+int ChannelSend(ChannelId id, char *buffer, int count);
+
+/* Receive up to "count" messages into "buffer", waiting until there is
+ * at least one.  Return the number of messages received, or -1 on error
+ * (if "buffer" cannot be written, no messages are taken from the channel).
+ */
+int ChannelReceive(ChannelId id, char *buffer, int count);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
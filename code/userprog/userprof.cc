@@ -0,0 +1,264 @@
+// userprof.cc
+//	Routines to profile the execution of user programs.
+//
+//	The counters are kept per instruction of the code segment; basic
+//	blocks and procedures are only worked out when the profile is
+//	printed.  A basic block starts at every instruction reached by a
+//	jump or a taken branch, and runs until the next one; a branch
+//	that is not taken does not split it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "userprof.h"
+#include "noff.h"
+
+static UserProfile *profiles = NULL;	// every program profiled so far
+
+//----------------------------------------------------------------------
+// UserProfile::UserProfile
+// 	Initialize the profile of a user program, with every counter at
+//	zero, and read the procedure names that follow its segments.
+//	If there are none (the NOFF file was made by an older coff2noff),
+//	addresses are printed in hex.
+//
+//	"fileName" -- the name of the program, for the report
+//	"executable" -- the NOFF file of the program
+//	"noffH" -- its header, already in host byte order
+//----------------------------------------------------------------------
+
+UserProfile::UserProfile(const char *fileName, OpenFile *executable,
+			 NoffHeader *noffH)
+{
+    NoffSymHeader symH;
+    int i, symbolsAt;
+
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    codeStart = noffH->code.virtualAddr;
+    numInstructions = noffH->code.size / 4;
+    executed = new int[numInstructions];
+    entered = new int[numInstructions];
+    called = new int[numInstructions];
+    for (i = 0; i < numInstructions; i++)
+	executed[i] = entered[i] = called[i] = 0;
+    outside = 0;
+    next = NULL;
+
+    numSymbols = 0;
+    symbols = NULL;
+    names = NULL;
+    symbolsAt = noffH->code.inFileAddr + noffH->code.size;
+    if (noffH->initData.size > 0 &&
+	    noffH->initData.inFileAddr + noffH->initData.size > symbolsAt)
+	symbolsAt = noffH->initData.inFileAddr + noffH->initData.size;
+    if (executable->ReadAt((char *)&symH, sizeof(symH), symbolsAt)
+		!= sizeof(symH)
+	    || WordToHost(symH.symMagic) != NOFFSYMMAGIC)
+	return;
+
+    numSymbols = WordToHost(symH.numSymbols);
+    symbols = new NoffSymbol[numSymbols];
+    names = new char[WordToHost(symH.stringSize)];
+    symbolsAt += sizeof(symH);
+    executable->ReadAt((char *)symbols, numSymbols * sizeof(NoffSymbol),
+			symbolsAt);
+    executable->ReadAt(names, WordToHost(symH.stringSize),
+			symbolsAt + numSymbols * sizeof(NoffSymbol));
+    for (i = 0; i < numSymbols; i++) {
+	symbols[i].value = WordToHost(symbols[i].value);
+	symbols[i].nameOffset = WordToHost(symbols[i].nameOffset);
+    }
+    DEBUG('a', "Read %d symbols of \"%s\"\n", numSymbols, name);
+}
+
+//----------------------------------------------------------------------
+// UserProfile::~UserProfile
+// 	De-allocate the profile.
+//----------------------------------------------------------------------
+
+UserProfile::~UserProfile()
+{
+    delete [] name;
+    delete [] executed;
+    delete [] entered;
+    delete [] called;
+    delete [] symbols;
+    delete [] names;
+}
+
+//----------------------------------------------------------------------
+// UserProfile::FindSymbol
+// 	Return the procedure containing "pc" (the last one starting at or
+//	before it), or -1 if "pc" comes before every procedure.
+//----------------------------------------------------------------------
+
+int
+UserProfile::FindSymbol(int pc)
+{
+    int low = 0, high = numSymbols - 1, found = -1;
+
+    while (low <= high) {			// binary search
+	int mid = (low + high) / 2;
+
+	if (symbols[mid].value <= pc) {
+	    found = mid;
+	    low = mid + 1;
+	} else
+	    high = mid - 1;
+    }
+    return found;
+}
+
+const char *
+UserProfile::SymbolName(int i)
+{
+    return names + symbols[i].nameOffset;
+}
+
+//----------------------------------------------------------------------
+// UserProfile::PrintLocation
+// 	Print "pc" as an offset from the procedure containing it.
+//----------------------------------------------------------------------
+
+void
+UserProfile::PrintLocation(int pc)
+{
+    int i = FindSymbol(pc);
+
+    if (i < 0)
+	printf("0x%x", pc);
+    else if (pc == symbols[i].value)
+	printf("%s", SymbolName(i));
+    else
+	printf("%s+0x%x", SymbolName(i), pc - symbols[i].value);
+}
+
+//----------------------------------------------------------------------
+// UserProfile::Print
+// 	Print how many instructions each procedure executed, and how many
+//	times it was called, in decreasing order of instructions; then the
+//	NumHotBlocks basic blocks that executed the most instructions.
+//----------------------------------------------------------------------
+
+void
+UserProfile::Print()
+{
+    int i, j, k, total = 0;
+
+    for (i = 0; i < numInstructions; i++)
+	total += executed[i];
+    printf("Profile of \"%s\": %d instructions", name, total);
+    if (outside > 0)
+	printf(", %d outside the code segment", outside);
+    printf("\n\n");
+    if (total == 0)
+	return;
+
+    // Add up the counts of each procedure.  Slot 0 is for the code 
+    // before the first procedure (all of it, if there are no symbols).
+    int numProcs = numSymbols + 1;
+    int *procInstructions = new int[numProcs];
+    int *procCalls = new int[numProcs];
+    int *order = new int[numProcs];
+
+    for (i = 0; i < numProcs; i++) {
+	procInstructions[i] = procCalls[i] = 0;
+	order[i] = i;
+    }
+    for (i = 0; i < numInstructions; i++) {
+	j = FindSymbol(codeStart + i * 4) + 1;
+	procInstructions[j] += executed[i];
+	procCalls[j] += called[i];
+    }
+    for (i = 1; i < numProcs; i++)		// insertion sort
+	for (j = i; j > 0 && procInstructions[order[j]] >
+				procInstructions[order[j - 1]]; j--) {
+	    k = order[j];
+	    order[j] = order[j - 1];
+	    order[j - 1] = k;
+	}
+
+    printf("  %%instr  instructions     calls  procedure\n");
+    for (i = 0; i < numProcs && procInstructions[order[i]] > 0; i++) {
+	j = order[i];
+	printf("  %6.2f  %12d  %8d  ", 100.0 * procInstructions[j] / total,
+		procInstructions[j], procCalls[j]);
+	if (j == 0)
+	    printf("0x%x\n", codeStart);
+	else
+	    printf("%s\n", SymbolName(j - 1));
+    }
+    delete [] procInstructions;
+    delete [] procCalls;
+    delete [] order;
+
+    // Keep the hottest basic blocks in "hot", sorted.
+    int hot[NumHotBlocks], hotInstructions[NumHotBlocks], numHot = 0;
+
+    for (i = 0; i < numInstructions; i = j) {
+	int instructions = executed[i];
+
+	for (j = i + 1; j < numInstructions && entered[j] == 0; j++)
+	    instructions += executed[j];
+	if (instructions == 0 || (numHot == NumHotBlocks &&
+			instructions <= hotInstructions[numHot - 1]))
+	    continue;
+	if (numHot < NumHotBlocks)
+	    numHot++;
+	for (k = numHot - 1; k > 0 && hotInstructions[k - 1] < instructions;
+									k--) {
+	    hot[k] = hot[k - 1];
+	    hotInstructions[k] = hotInstructions[k - 1];
+	}
+	hot[k] = i;
+	hotInstructions[k] = instructions;
+    }
+
+    printf("\n  %%instr  instructions   entries  basic block\n");
+    for (i = 0; i < numHot; i++) {
+	printf("  %6.2f  %12d  %8d  ", 100.0 * hotInstructions[i] / total,
+		hotInstructions[i], entered[hot[i]]);
+	PrintLocation(codeStart + hot[i] * 4);
+	printf("\n");
+    }
+    printf("\n");
+}
+
+//----------------------------------------------------------------------
+// ProfileProgram
+// 	Return the profile of the program "fileName", creating it the
+//	first time the program is loaded.
+//----------------------------------------------------------------------
+
+UserProfile *
+ProfileProgram(const char *fileName, OpenFile *executable, NoffHeader *noffH)
+{
+    UserProfile *profile, **last = &profiles;
+
+    for (profile = profiles; profile != NULL; profile = profile->next) {
+	if (!strcmp(profile->Name(), fileName))
+	    return profile;
+	last = &profile->next;
+    }
+    profile = new UserProfile(fileName, executable, noffH);
+    *last = profile;
+    return profile;
+}
+
+//----------------------------------------------------------------------
+// PrintUserProfiles
+// 	Print the profile of every program run, in the order they were
+//	first loaded.
+//----------------------------------------------------------------------
+
+void
+PrintUserProfiles()
+{
+    for (UserProfile *profile = profiles; profile != NULL;
+					profile = profile->next)
+	profile->Print();
+}
@@ -0,0 +1,107 @@
+// userprof.h
+//	Data structures to profile the execution of user programs.
+//
+//	When user programs are profiled (-up), the simulated CPU counts
+//	how many times each instruction of the program is executed, how
+//	many times each instruction is reached by a jump or a taken branch
+//	(so it starts a basic block), and how many times each address is
+//	the target of a call (jal or jalr).
+//
+//	The counts are resolved against the procedure names that coff2noff
+//	copies after the segments of the NOFF file (cf. bin/noff.h), and
+//	printed on halt as a flat profile and a list of the hottest basic
+//	blocks.
+//
+//	A program that is run more than once (e.g., by the shell)
+//	accumulates its counts in a single profile.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef USERPROF_H
+#define USERPROF_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "openfile.h"
+
+struct noffHeader;
+struct noffSymbol;
+
+// Number of basic blocks listed on halt.
+#define NumHotBlocks	10
+
+// The following class defines the profile of one user program.
+
+class UserProfile {
+  public:
+    UserProfile(const char *fileName, OpenFile *executable,
+		struct noffHeader *noffH);
+					// Initialize a profile for the code
+					// of "executable"
+    ~UserProfile();			// De-allocate the profile
+
+    void Count(int pc, int prevPC);	// The instruction at "pc" was
+					// executed, after the one at "prevPC"
+    void Call(int target);		// The procedure at "target" was
+					// called
+
+    void Print();			// Print the flat profile and the
+					// hottest basic blocks
+
+    const char *Name() { return name; }
+    UserProfile *next;			// Next profiled program
+
+  private:
+    char *name;				// File name of the program
+    int codeStart;			// Virtual address of the code
+    int numInstructions;		// Words in the code segment
+    int *executed;			// Times each instruction ran
+    int *entered;			// Times it was jumped to
+    int *called;			// Times it was called
+    int outside;			// Instructions run outside the code
+					// segment
+
+    int numSymbols;			// Procedures, sorted by address
+    struct noffSymbol *symbols;
+    char *names;			// Their names
+
+    int FindSymbol(int pc);		// Procedure containing "pc", or -1
+    const char *SymbolName(int i);
+    void PrintLocation(int pc);		// As "procedure+offset"
+};
+
+// Count and Call are called for every user instruction, so they are
+// inlined.
+
+inline void
+UserProfile::Count(int pc, int prevPC)
+{
+    unsigned int i = (unsigned int) (pc - codeStart) / 4;
+
+    if (i >= (unsigned int) numInstructions) {
+	outside++;
+	return;
+    }
+    executed[i]++;
+    if (pc != prevPC + 4)
+	entered[i]++;
+}
+
+inline void
+UserProfile::Call(int target)
+{
+    unsigned int i = (unsigned int) (target - codeStart) / 4;
+
+    if (i < (unsigned int) numInstructions)
+	called[i]++;
+}
+
+extern UserProfile *ProfileProgram(const char *fileName,
+			OpenFile *executable, struct noffHeader *noffH);
+					// The profile of "fileName",
+					// creating it the first time
+extern void PrintUserProfiles();	// Print every profile, on halt
+
+#endif // USERPROF_H